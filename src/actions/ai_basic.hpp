@@ -1,7 +1,12 @@
 #pragma once
+#include <memory_resource>
+#include <utility>
+
+#include "../actor_index.hpp"
 #include "../distance.hpp"
 #include "../globals.hpp"
 #include "../pathfinding/astar.hpp"
+#include "../type_registry.hpp"
 #include "../types/position.hpp"
 #include "ai_confused.hpp"
 #include "bump.hpp"
@@ -9,23 +14,21 @@
 namespace action {
 class BasicAI : public Action {
  public:
+  void plan(const World& world, const Actor& actor, std::pmr::memory_resource& arena) override {
+    planned_ = false;
+    if (actor.stats.confused_turns) return;
+    update_path(world, actor, arena);
+    planned_ = true;
+  }
+
   [[nodiscard]] Result perform(GameContext& context, Actor& actor) override {
     auto& world = *context.world;
+    const bool was_planned = std::exchange(planned_, false);
     if (actor.stats.confused_turns) {
       --actor.stats.confused_turns;
       return ConfusedAI{}.perform(context, actor);
     }
-    const Map& map = world.active_map();
-    const auto& player = world.active_player();
-    const auto can_see_player = map.visible.at(actor.pos);
-    if (can_see_player) {
-      auto cost = util::Array2D<int>{map.get_size()};
-      with_indexes(
-          map, [&cost, &map](int x, int y) { return cost.at({x, y}) = map.tiles.at({x, y}) == Tiles::wall ? 0 : 1; });
-      for (auto actor_id : world.active_actors) cost.at(world.get(actor_id).pos) += 10;
-      cost.at(player.pos) = 1;
-      path_ = pf::get_astar2d_path(cost, actor.pos, player.pos);
-    }
+    if (!was_planned || is_path_blocked(world, actor)) update_path(world, actor, context.turn_arena.local());
     if (path_.size() && path_.back() == actor.pos) path_.pop_back();
     if (path_.size()) {
       const auto move_dir = path_.back() - actor.pos;
@@ -38,9 +41,76 @@ class BasicAI : public Action {
     return Success{};
   };
 
+  /// BasicAI saves no fields, its path is planned again after loading.
+  template <typename Self, typename Visitor>
+  static void visit_fields(Self&, Visitor&&) {}
+
  private:
+  /// Path towards the player if they can be seen, otherwise keep following the last path.
+  /// The search is done in `arena`, only the path itself is kept.
+  void update_path(const World& world, const Actor& actor, std::pmr::memory_resource& arena) {
+    const Map& map = world.active_map();
+    const auto& player = world.active_player();
+    const auto can_see_player = map.visible.at(actor.pos);
+    if (!can_see_player) return;
+    // Path within a window around this actor and the player first, so that the cost of this does not depend on the
+    // map size or on how many other actors exist.  Detours around long walls can leave the window, those fall back
+    // to searching the whole map.
+    const auto window_begin = Position{
+        std::max(0, std::min(actor.pos.x, player.pos.x) - PATH_MARGIN),
+        std::max(0, std::min(actor.pos.y, player.pos.y) - PATH_MARGIN)};
+    const auto window_end = Position{
+        std::min(map.get_width(), std::max(actor.pos.x, player.pos.x) + PATH_MARGIN + 1),
+        std::min(map.get_height(), std::max(actor.pos.y, player.pos.y) + PATH_MARGIN + 1)};
+    if (find_path(world, actor, window_begin, window_end, arena)) return;
+    if (window_begin == Position{0, 0} && window_end == Position{map.get_width(), map.get_height()}) return;
+    find_path(world, actor, {0, 0}, {map.get_width(), map.get_height()}, arena);
+  }
+
+  /// Set path_ to the path towards the player within the map tiles from `window_begin` to `window_end`.
+  /// Returns false if the player can not be reached within them.
+  auto find_path(
+      const World& world,
+      const Actor& actor,
+      Position window_begin,
+      Position window_end,
+      std::pmr::memory_resource& arena) -> bool {
+    const Map& map = world.active_map();
+    const auto& player = world.active_player();
+    // The costs are padded with a blocked border, so the search can skip bounds checks, see pf::is_bordered.
+    const auto origin = window_begin - Position{1, 1};
+    const auto window_size = window_end - window_begin;
+    auto cost = util::pmr::Array2D<int>{{window_size.x + 2, window_size.y + 2}, &arena};
+    const auto tiles = map.tiles.subview(window_begin, window_size);
+    const auto window_cost = cost.subview({1, 1}, window_size);
+    for (int y{0}; y < window_size.y; ++y) {
+      const auto tiles_row = tiles.row(y);
+      const auto cost_row = window_cost.row(y);
+      for (int x{0}; x < window_size.x; ++x) {
+        if (tiles_row[x] == Tiles::wall) continue;
+        cost_row[x] = 1 + 10 * static_cast<int>(count_actors_at(world, window_begin + Position{x, y}));
+      }
+    }
+    cost.at(player.pos - origin) = 1;
+    const auto path = pf::get_astar2d_path(
+        cost, actor.pos - origin, player.pos - origin, 2, 3, std::pmr::polymorphic_allocator<Position>{&arena});
+    path_.clear();  // Keeps its capacity, so following paths does not allocate either.
+    for (const auto step : path) path_.emplace_back(step + origin);
+    return path_.back() == actor.pos;
+  }
+
+  /// Return true if another actor moved onto the next step of this path after it was planned.
+  [[nodiscard]] auto is_path_blocked(const World& world, const Actor& actor) const -> bool {
+    auto next = path_.rbegin();
+    if (next != path_.rend() && *next == actor.pos) ++next;
+    return next != path_.rend() && *next != world.active_player().pos && count_actors_at(world, *next);
+  }
+
+  static constexpr int PATH_MARGIN = 4;  // Extra tiles around the actor and player which paths may detour through.
   std::vector<Position> path_;
+  bool planned_ = false;  // True if path_ was updated by plan this turn.
   static auto sign_(int n) -> int { return (n == 0 ? 0 : (n < 0 ? -1 : 1)); }
 };
+inline const bool BASIC_AI_REGISTERED = get_ai_types().add<BasicAI>("BasicAI", 1);
 
 }  // namespace action
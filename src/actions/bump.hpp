@@ -3,6 +3,7 @@
 
 #include <algorithm>
 
+#include "../actor_index.hpp"
 #include "../combat.hpp"
 #include "../fov.hpp"
 #include "../globals.hpp"
@@ -35,15 +36,12 @@ class Bump : public Action {
       return Failure{"That way is blocked!"};
     }
 
-    for (auto& other_id : world.active_actors) {
-      auto& other = world.get(other_id);
-      if (other.pos == dest) {
-        combat::attack(world, actor, other);
-        return Success{};
-      }
+    if (const auto other_id = find_actor_id_at(world, dest); other_id) {
+      combat::attack(world, actor, world.get(*other_id));
+      return Success{};
     }
 
-    actor.pos = dest;
+    move_actor(world, actor, dest);
     if (&actor == &world.active_player()) update_fov(map, actor.pos);
     return Success{};
   };
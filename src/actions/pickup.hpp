@@ -27,6 +27,7 @@ class Pickup : public Action {
       actor.stats.inventory.emplace_back(std::move(item));
     }
     map.items.erase(first);
+    map.dirty = true;
     return Success{};
   };
 };
@@ -21,10 +21,11 @@ class UseStairs : public Action {
     }
     const auto dest = MapID{current_map.id.name, current_map.id.level + (downwards_ ? 1 : -1)};
     if (dest.level <= 0) return Failure{"You are already at the top of the caves."};
-    Map& next_map = procgen::generate_level(world, dest.level);
+    Map& next_map = procgen::generate_level(
+        world, dest.level, context.level_params, context.simulate_frozen_levels, &context.scheduler);
     // Perform map movement.
-    activate_map(world, next_map);
-    actor.pos = find_fixture_by_name(next_map, !downwards_ ? "down stairs" : "up stairs").value();
+    activate_map(world, next_map, context.simulate_frozen_levels, &context.scheduler);
+    move_actor(world, actor, find_fixture_by_name(next_map, !downwards_ ? "down stairs" : "up stairs").value());
     return Success{};
   }
 
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+
+#include "types/actor.hpp"
+#include "types/position.hpp"
+#include "types/world.hpp"
+
+/// Add `actor` to the spatial index at its current position.
+inline auto index_actor(World& world, const Actor& actor) -> void { world.actor_positions.emplace(actor.pos, actor.id); }
+
+/// Remove `actor` from the spatial index.  Does nothing if the actor was not indexed.
+inline auto unindex_actor(World& world, const Actor& actor) -> void {
+  auto [first, last] = world.actor_positions.equal_range(actor.pos);
+  for (auto it = first; it != last; ++it) {
+    if (it->second == actor.id) {
+      world.actor_positions.erase(it);
+      return;
+    }
+  }
+}
+
+/// Move `actor` to `dest` while keeping the spatial index in sync.
+inline auto move_actor(World& world, Actor& actor, Position dest) -> void {
+  unindex_actor(world, actor);
+  actor.pos = dest;
+  index_actor(world, actor);
+}
+
+/// Rebuild the spatial index from the currently active actors.
+inline auto reindex_actors(World& world) -> void {
+  world.actor_positions.clear();
+  world.actor_positions.reserve(world.active_actors.size());
+  for (auto actor_id : world.active_actors) index_actor(world, world.get(actor_id));
+}
+
+/// Return the number of active actors standing at `pos`.
+inline auto count_actors_at(const World& world, Position pos) -> std::size_t { return world.actor_positions.count(pos); }
+
+/// Return the ID of an active actor at `pos` if one exists.
+inline auto find_actor_id_at(const World& world, Position pos) -> std::optional<ActorID> {
+  if (const auto found = world.actor_positions.find(pos); found != world.actor_positions.end()) return found->second;
+  return {};
+}
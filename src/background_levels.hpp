@@ -0,0 +1,109 @@
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "types/background_level.hpp"
+#include "types/map.hpp"
+#include "types/world.hpp"
+
+namespace background {
+constexpr int STEP_TURNS = 10;  // The number of turns covered by one coarse step.
+
+/// Simulate one coarse step of a frozen level.  Monsters wander and their confusion wears off.
+inline auto simulate_step(BackgroundLevelState& level) -> void {
+  for (auto& node : level.actors) {
+    auto& actor = node.mapped();
+    actor.stats.confused_turns = std::max(0, actor.stats.confused_turns - STEP_TURNS);
+    if (!actor.ai) continue;
+    const auto dest =
+        actor.pos + Position{static_cast<int>(level.rng() % 3) - 1, static_cast<int>(level.rng() % 3) - 1};
+    if (!level.tiles.in_bounds(dest) || level.tiles.at(dest) != Tiles::floor) continue;
+    if (level.occupied.contains(dest) || level.reserved.contains(dest)) continue;
+    level.occupied.erase(actor.pos);
+    actor.pos = dest;
+    level.occupied.insert(dest);
+  }
+}
+
+/// Move the frozen actors of `map` out of the world and keep simulating them as tasks on `scheduler`.
+/// The RNG and step count of `state` are kept, `start_turn` is the turn its first step counts from.
+/// Without a scheduler each step runs on the thread which advances the world.
+inline auto start(
+    World& world, const Map& map, BackgroundLevelState state, int start_turn, jobs::Scheduler* scheduler) -> void {
+  state.tiles = map.tiles;
+  // Keep the stairs free, so that a returning player never arrives on top of a monster.
+  for (const auto& [pos, fixture] : map.fixtures) state.reserved.insert(pos);
+  for (auto actor_id : map.frozen_actors) {
+    auto node = world.actors.extract(actor_id);
+    if (node.empty()) continue;
+    state.occupied.insert(node.mapped().pos);
+    state.actors.emplace_back(std::move(node));
+  }
+  world.background_levels[map.id] =
+      std::make_unique<BackgroundLevel>(std::move(state), start_turn, simulate_step, scheduler);
+}
+
+/// Move the frozen actors of `map` out of the world and keep simulating them as tasks on `scheduler`.
+inline auto start(World& world, const Map& map, jobs::Scheduler* scheduler) -> void {
+  auto state = BackgroundLevelState{};
+  state.rng.seed(world.rng());
+  start(world, map, std::move(state), world.turn, scheduler);
+}
+
+/// Stop simulating `map_id` and return its actors to the world.  Does nothing if that level is not being simulated.
+inline auto reclaim(World& world, const MapID& map_id) -> void {
+  const auto found = world.background_levels.find(map_id);
+  if (found == world.background_levels.end()) return;
+  if (auto map = world.maps.find(map_id); map != world.maps.end()) map->second.dirty = true;  // Its actors moved.
+  auto state = found->second->stop();
+  world.background_levels.erase(found);  // `map_id` may refer to the erased key.
+  for (auto& node : state.actors) world.actors.insert(std::move(node));
+}
+
+/// Return every simulated actor to the world, this must be done before the world is saved.
+inline auto reclaim_all(World& world) -> void {
+  while (world.background_levels.size()) reclaim(world, world.background_levels.begin()->first);
+}
+
+/// A level stopped by `pause_all`, holding what it needs to continue where it left off.
+struct PausedLevel {
+  MapID map_id;
+  BackgroundLevelState state;  // Without actors, those were returned to the world.
+  int start_turn;
+};
+
+/// Return every simulated actor to the world without losing the progress of each level, see `resume_all`.
+[[nodiscard]] inline auto pause_all(World& world) -> std::vector<PausedLevel> {
+  auto paused = std::vector<PausedLevel>{};
+  for (auto& [map_id, level] : world.background_levels) {
+    const int start_turn = level->get_start_turn();
+    auto& it = paused.emplace_back(PausedLevel{map_id, level->stop(), start_turn});
+    for (auto& node : it.state.actors) world.actors.insert(std::move(node));
+    it.state.actors.clear();
+    it.state.occupied.clear();
+    it.state.reserved.clear();
+    if (auto map = world.maps.find(map_id); map != world.maps.end()) map->second.dirty = true;  // Its actors moved.
+  }
+  world.background_levels.clear();
+  return paused;
+}
+
+/// Continue simulating the levels stopped by `pause_all`.
+inline auto resume_all(World& world, std::vector<PausedLevel> paused, jobs::Scheduler* scheduler) -> void {
+  for (auto& it : paused) start(world, world.maps.at(it.map_id), std::move(it.state), it.start_turn, scheduler);
+}
+
+/// Let each simulated level catch up to the current turn.
+inline auto advance(World& world) -> void {
+  for (auto& [map_id, level] : world.background_levels) {
+    level->advance_to((world.turn - level->get_start_turn()) / STEP_TURNS);
+  }
+}
+
+/// Return true if `id` belongs to a level being simulated.
+inline auto owns(const World& world, ActorID id) -> bool {
+  return std::ranges::any_of(world.background_levels, [id](const auto& it) { return it.second->owns(id); });
+}
+}  // namespace background
@@ -0,0 +1,117 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bot.hpp"
+#include "globals.hpp"
+#include "headless.hpp"
+#include "jobs.hpp"
+#include "procgen/level_params.hpp"
+#include "world_init.hpp"
+
+/*****************************************************************************
+    Monte-Carlo batches of headless games, used to tune level parameters.
+
+    Every world gets its own GameContext, World, RNG and bot::Policy, and nothing mutable is shared between them, so
+    worlds are spread over the scheduler with one task each and the batch scales with the number of cores.  The
+    GameContext of each world has no workers of its own, so anything it would run in parallel runs inline on the
+    thread simulating that world.  Results only depend on the options, never on the number of threads.
+ */
+namespace batch {
+struct Options {
+  int worlds = 1000;
+  int turns = 1000;  // The most turns to play in each world.
+  std::mt19937::result_type seed = 0;  // World `i` uses the seed `seed + i`.
+  std::string policy = "explorer";
+  procgen::LevelParams level_params;
+};
+
+/// How a single world played out.
+struct Outcome {
+  std::mt19937::result_type seed = 0;
+  int depth = 0;  // The deepest dungeon level reached.
+  int turns = 0;  // Turns survived.
+  int64_t damage_taken = 0;
+  int player_level = 1;
+  bool died = false;
+};
+
+/// Play one world with a new policy and return how it went.
+inline auto run_world(const Options& options, std::mt19937::result_type seed) -> Outcome {
+  auto context = GameContext{};
+  context.level_params = options.level_params;
+  context.world = new_world(seed, options.level_params);
+  auto policy = bot::make_policy(options.policy, seed);
+  if (!policy) throw std::runtime_error("Unknown policy: " + options.policy);
+  auto outcome = Outcome{.seed = seed};
+  const auto report = headless::run(context, *policy, options.turns);
+  const auto& world = *context.world;
+  for (const auto& [map_id, map] : world.maps) outcome.depth = std::max(outcome.depth, map_id.level);
+  outcome.turns = report.turns;
+  outcome.damage_taken = report.damage_taken;
+  outcome.player_level = world.active_player().stats.level;
+  outcome.died = report.player_died;
+  return outcome;
+}
+
+/// Play `options.worlds` worlds on `scheduler` and return their outcomes in seed order.
+inline auto run(const Options& options, jobs::Scheduler& scheduler) -> std::vector<Outcome> {
+  auto outcomes = std::vector<Outcome>(options.worlds);
+  scheduler.parallel_for(0, options.worlds, 1, [&options, &outcomes](int i) {
+    outcomes.at(i) = run_world(options, options.seed + static_cast<std::mt19937::result_type>(i));
+  });
+  return outcomes;
+}
+
+/// The distribution of one statistic over a batch.
+struct Distribution {
+  double mean = 0;
+  double p10 = 0;
+  double p50 = 0;
+  double p90 = 0;
+};
+
+/// Aggregated statistics of a batch.
+struct Summary {
+  int worlds = 0;
+  int deaths = 0;
+  Distribution depth;
+  Distribution turns;
+  Distribution damage_taken;
+  Distribution player_level;
+};
+
+/// Return the distribution of `values`, which are sorted in place.
+inline auto distribution(std::vector<double>& values) -> Distribution {
+  if (values.empty()) return {};
+  std::sort(values.begin(), values.end());
+  const auto percentile = [&values](int p) { return values.at((values.size() - 1) * p / 100); };
+  auto result = Distribution{};
+  for (const auto value : values) result.mean += value;
+  result.mean /= static_cast<double>(values.size());
+  result.p10 = percentile(10);
+  result.p50 = percentile(50);
+  result.p90 = percentile(90);
+  return result;
+}
+
+inline auto summarize(const std::vector<Outcome>& outcomes) -> Summary {
+  auto summary = Summary{};
+  summary.worlds = static_cast<int>(outcomes.size());
+  const auto get_distribution = [&outcomes](auto get) {
+    auto values = std::vector<double>{};
+    values.reserve(outcomes.size());
+    for (const auto& outcome : outcomes) values.emplace_back(static_cast<double>(get(outcome)));
+    return distribution(values);
+  };
+  summary.deaths = static_cast<int>(std::ranges::count_if(outcomes, [](const Outcome& it) { return it.died; }));
+  summary.depth = get_distribution([](const Outcome& it) { return it.depth; });
+  summary.turns = get_distribution([](const Outcome& it) { return it.turns; });
+  summary.damage_taken = get_distribution([](const Outcome& it) { return it.damage_taken; });
+  summary.player_level = get_distribution([](const Outcome& it) { return it.player_level; });
+  return summary;
+}
+}  // namespace batch
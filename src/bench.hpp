@@ -0,0 +1,72 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+/*****************************************************************************
+    Timing of engine routines in isolation, used by tools/bench.cpp.
+
+    `measure` runs a routine once to warm up, then repeatedly until it ran for at least `min_seconds` and
+    `min_iterations` times.  A setup function prepares the input of each run without being timed, so routines which
+    change their input are timed on the same input every run.  Inputs are made from a seed, so runs with the same
+    arguments time the same work and can be compared between builds.
+ */
+namespace bench {
+/// How long to run each routine for.
+struct Options {
+  double min_seconds = 0.5;
+  int min_iterations = 5;
+  int max_iterations = 1'000'000;
+};
+
+/// The time of each run of a routine, in milliseconds.
+struct Timing {
+  int iterations = 0;
+  double min = 0;
+  double median = 0;
+  double mean = 0;
+  double max = 0;
+};
+
+/// Keep the compiler from optimizing away the computation of `value`.
+template <typename T>
+inline void keep(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r"(&value) : "memory");
+#else
+  static const void* volatile sink;
+  sink = &value;
+#endif
+}
+
+/// Time `run(input)` on a fresh `input = setup()` for each run.  Only `run` is timed.
+/// `run` returns what it computed, or anything depending on it, so that the work is not optimized away.
+template <typename Setup, typename Run>
+inline auto measure(const Options& options, Setup&& setup, Run&& run) -> Timing {
+  using Clock = std::chrono::steady_clock;
+  {
+    auto input = setup();
+    keep(run(input));
+  }
+  auto samples = std::vector<double>{};
+  double elapsed = 0;
+  while (std::ssize(samples) < options.max_iterations &&
+         (elapsed < options.min_seconds || std::ssize(samples) < options.min_iterations)) {
+    auto input = setup();
+    const auto start = Clock::now();
+    keep(run(input));
+    const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    samples.emplace_back(seconds * 1000.0);
+    elapsed += seconds;
+  }
+  std::ranges::sort(samples);
+  return {
+      static_cast<int>(samples.size()),
+      samples.front(),
+      samples.at(samples.size() / 2),
+      std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size()),
+      samples.back()};
+}
+}  // namespace bench
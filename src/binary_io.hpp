@@ -0,0 +1,170 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "types/ndarray.hpp"
+
+/*****************************************************************************
+    Primitives for compact binary formats.
+
+    Integers are written as LEB128 varints, signed integers are zigzag encoded first so that small negative numbers
+    stay small.  Boolean arrays are packed eight to a byte.  Arrays of small enums are run-length encoded.
+ */
+namespace binary {
+/// Thrown when binary data can not be decoded.
+class DecodeError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+/// Appends encoded values to a byte buffer.
+class Writer {
+ public:
+  void write_byte(uint8_t value) { data_.push_back(static_cast<std::byte>(value)); }
+  void write_bytes(std::span<const std::byte> bytes) { data_.insert(data_.end(), bytes.begin(), bytes.end()); }
+
+  void write_varint(uint64_t value) {
+    while (value >= 0x80) {
+      write_byte(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    write_byte(static_cast<uint8_t>(value));
+  }
+  void write_signed(int64_t value) {
+    write_varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));  // Zigzag.
+  }
+  void write_string(std::string_view value) {
+    write_varint(value.size());
+    write_bytes(std::as_bytes(std::span{value.data(), value.size()}));
+  }
+
+  /// Write `array` as its shape followed by its values packed eight to a byte.
+  void write_bits(const util::Array2D<bool>& array) {
+    write_varint(array.get_width());
+    write_varint(array.get_height());
+    uint8_t byte = 0;
+    int bit = 0;
+    for (const bool value : array.get_container()) {
+      byte |= static_cast<uint8_t>(value) << bit;
+      if (++bit == 8) {
+        write_byte(byte);
+        byte = 0;
+        bit = 0;
+      }
+    }
+    if (bit) write_byte(byte);
+  }
+
+  /// Write `array` as its shape followed by runs of (length, value).  Values must fit in a byte.
+  template <typename T>
+  void write_runs(const util::Array2D<T>& array) {
+    write_varint(array.get_width());
+    write_varint(array.get_height());
+    const auto& values = array.get_container();
+    for (size_t i{0}; i < values.size();) {
+      size_t run_end = i + 1;
+      while (run_end < values.size() && values[run_end] == values[i]) ++run_end;
+      write_varint(run_end - i);
+      write_byte(static_cast<uint8_t>(values[i]));
+      i = run_end;
+    }
+  }
+
+  [[nodiscard]] auto data() const noexcept -> const std::vector<std::byte>& { return data_; }
+  [[nodiscard]] auto release() noexcept -> std::vector<std::byte> { return std::move(data_); }
+
+ private:
+  std::vector<std::byte> data_;
+};
+
+/// Decodes values written by Writer.  Throws DecodeError on truncated or malformed data.
+class Reader {
+ public:
+  explicit Reader(std::span<const std::byte> data) noexcept : data_{data} {}
+
+  [[nodiscard]] auto read_byte() -> uint8_t {
+    if (pos_ >= data_.size()) throw DecodeError("Unexpected end of data.");
+    return static_cast<uint8_t>(data_[pos_++]);
+  }
+  [[nodiscard]] auto read_bytes(size_t size) -> std::span<const std::byte> {
+    if (size > remaining()) throw DecodeError("Unexpected end of data.");
+    const auto bytes = data_.subspan(pos_, size);
+    pos_ += size;
+    return bytes;
+  }
+
+  [[nodiscard]] auto read_varint() -> uint64_t {
+    uint64_t value = 0;
+    for (int shift{0}; shift < 64; shift += 7) {
+      const auto byte = read_byte();
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) return value;
+    }
+    throw DecodeError("Varint is too long.");
+  }
+  [[nodiscard]] auto read_signed() -> int64_t {
+    const auto value = read_varint();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  }
+  /// Read a varint which must fit in an int.
+  [[nodiscard]] auto read_int() -> int { return checked_int(read_signed()); }
+  /// Read a varint count of elements, each of which takes at least one byte.
+  [[nodiscard]] auto read_size() -> size_t {
+    const auto size = read_varint();
+    if (size > remaining()) throw DecodeError("Size is larger than the remaining data.");
+    return static_cast<size_t>(size);
+  }
+  [[nodiscard]] auto read_string() -> std::string {
+    const auto bytes = read_bytes(read_size());
+    return std::string{reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+  }
+
+  [[nodiscard]] auto read_bits() -> util::Array2D<bool> {
+    auto array = util::Array2D<bool>{read_shape()};
+    auto& values = array.get_container();
+    const auto bytes = read_bytes((values.size() + 7) / 8);
+    for (size_t i{0}; i < values.size(); ++i) values[i] = (static_cast<uint8_t>(bytes[i / 8]) >> (i % 8)) & 1;
+    return array;
+  }
+
+  template <typename T>
+  [[nodiscard]] auto read_runs() -> util::Array2D<T> {
+    auto array = util::Array2D<T>{read_shape()};
+    auto& values = array.get_container();
+    for (size_t i{0}; i < values.size();) {
+      const auto length = read_varint();
+      const auto value = static_cast<T>(read_byte());
+      if (length == 0 || length > values.size() - i) throw DecodeError("Run length is out of range.");
+      std::fill_n(values.begin() + static_cast<ptrdiff_t>(i), length, value);
+      i += static_cast<size_t>(length);
+    }
+    return array;
+  }
+
+  [[nodiscard]] auto remaining() const noexcept -> size_t { return data_.size() - pos_; }
+
+ private:
+  static auto checked_int(int64_t value) -> int {
+    if (value < INT32_MIN || value > INT32_MAX) throw DecodeError("Integer is out of range.");
+    return static_cast<int>(value);
+  }
+  auto read_shape() -> std::array<int, 2> {
+    const auto width = read_varint();
+    const auto height = read_varint();
+    if (width > 0xffff || height > 0xffff) throw DecodeError("Array shape is out of range.");
+    return {static_cast<int>(width), static_cast<int>(height)};
+  }
+
+  std::span<const std::byte> data_;
+  size_t pos_ = 0;
+};
+}  // namespace binary
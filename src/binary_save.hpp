@@ -0,0 +1,318 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "actor_index.hpp"
+#include "binary_io.hpp"
+#include "jobs.hpp"
+#include "type_registry.hpp"
+#include "types/actor.hpp"
+#include "types/map.hpp"
+#include "types/world.hpp"
+
+/*****************************************************************************
+    The binary save format.
+
+    A save is the MAGIC bytes and a varint FORMAT_VERSION followed by the World:
+        turn, RNG state, message log, schedule, dormant actors, current MapID, actors, then each map.
+    Each map is stored as its MapID and a varint byte length followed by the encoded map, so maps can be skipped.
+    Tile layers are run-length encoded and boolean layers are bit-packed, see binary_io.hpp.  Items and AI are
+    written as a type tag followed by that type's fields, see type_registry.hpp.
+
+    The format only changes by adding a new FORMAT_VERSION, older versions must stay readable.
+    Version 2 added the frozen actors of each map to the manifest of incremental saves, see save_segments.hpp.
+ */
+namespace binary {
+inline constexpr auto MAGIC = std::array<char, 4>{'R', 'L', 'S', 'V'};
+inline constexpr uint64_t FORMAT_VERSION = 2;
+
+inline void write_color(Writer& out, const tcod::ColorRGB& color) {
+  out.write_byte(color.r);
+  out.write_byte(color.g);
+  out.write_byte(color.b);
+}
+[[nodiscard]] inline auto read_color(Reader& in) -> tcod::ColorRGB {
+  auto color = tcod::ColorRGB{};
+  color.r = in.read_byte();
+  color.g = in.read_byte();
+  color.b = in.read_byte();
+  return color;
+}
+
+inline void write_position(Writer& out, Position pos) {
+  out.write_signed(pos.x);
+  out.write_signed(pos.y);
+}
+[[nodiscard]] inline auto read_position(Reader& in) -> Position {
+  const int x = in.read_int();
+  return {x, in.read_int()};
+}
+
+inline void write_actor_id(Writer& out, ActorID id) { out.write_varint(static_cast<uint32_t>(id)); }
+[[nodiscard]] inline auto read_actor_id(Reader& in) -> ActorID {
+  const auto id = in.read_varint();
+  if (id > UINT32_MAX) throw DecodeError("Actor ID is out of range.");
+  return static_cast<ActorID>(id);
+}
+
+inline void write_map_id(Writer& out, const MapID& map_id) {
+  out.write_string(map_id.name);
+  out.write_signed(map_id.level);
+}
+[[nodiscard]] inline auto read_map_id(Reader& in) -> MapID {
+  auto map_id = MapID{};
+  map_id.name = in.read_string();
+  map_id.level = in.read_int();
+  return map_id;
+}
+
+inline void write_item(Writer& out, const Item& item) { get_item_types().write(out, item); }
+[[nodiscard]] inline auto read_item(Reader& in) -> std::unique_ptr<Item> { return get_item_types().read(in); }
+
+/// Tag 0 is written for actors without AI.
+inline void write_ai(Writer& out, const action::Action* ai) {
+  if (!ai) {
+    out.write_byte(0);
+    return;
+  }
+  action::get_ai_types().write(out, *ai);
+}
+[[nodiscard]] inline auto read_ai(Reader& in) -> std::unique_ptr<action::Action> {
+  const auto tag = in.read_byte();
+  if (tag == 0) return nullptr;
+  return action::get_ai_types().read(in, tag);
+}
+
+inline void write_actor(Writer& out, const Actor& actor) {
+  write_position(out, actor.pos);
+  out.write_string(actor.name);
+  out.write_signed(actor.ch);
+  write_color(out, actor.fg);
+  const auto& stats = actor.stats;
+  for (const int value : {stats.max_hp, stats.hp, stats.attack, stats.defense, stats.level, stats.xp}) {
+    out.write_signed(value);
+  }
+  out.write_signed(stats.confused_turns);
+  out.write_varint(stats.inventory.size());
+  for (const auto& item : stats.inventory) write_item(out, *item);
+  write_ai(out, actor.ai.get());
+}
+[[nodiscard]] inline auto read_actor(Reader& in) -> Actor {
+  auto actor = Actor{};
+  actor.pos = read_position(in);
+  actor.name = in.read_string();
+  actor.ch = in.read_int();
+  actor.fg = read_color(in);
+  auto& stats = actor.stats;
+  for (int* value : {&stats.max_hp, &stats.hp, &stats.attack, &stats.defense, &stats.level, &stats.xp}) {
+    *value = in.read_int();
+  }
+  stats.confused_turns = in.read_int();
+  stats.inventory.resize(in.read_size());
+  for (auto& item : stats.inventory) item = read_item(in);
+  actor.ai = read_ai(in);
+  return actor;
+}
+
+/// Encode everything saved for `map` except its MapID.
+inline void write_map(Writer& out, const Map& map) {
+  out.write_runs(map.tiles);
+  out.write_bits(map.explored);
+  out.write_bits(map.visible);
+  out.write_varint(map.items.size());
+  for (const auto& [pos, item] : map.items) {
+    write_position(out, pos);
+    write_item(out, *item);
+  }
+  out.write_varint(map.fixtures.size());
+  for (const auto& [pos, fixture] : map.fixtures) {
+    write_position(out, pos);
+    out.write_string(fixture.name);
+    out.write_signed(fixture.ch);
+    write_color(out, fixture.fg);
+  }
+  out.write_varint(map.frozen_actors.size());
+  for (const auto actor_id : map.frozen_actors) write_actor_id(out, actor_id);
+}
+[[nodiscard]] inline auto read_map(Reader& in) -> Map {
+  auto map = Map{};
+  map.tiles = in.read_runs<Tiles>();
+  map.explored = in.read_bits();
+  map.visible = in.read_bits();
+  if (map.explored.get_shape() != map.tiles.get_shape() || map.visible.get_shape() != map.tiles.get_shape()) {
+    throw DecodeError("Map layers have different shapes.");
+  }
+  for (size_t i{0}, count{in.read_size()}; i < count; ++i) {
+    const auto pos = read_position(in);
+    map.items.emplace(pos, read_item(in));
+  }
+  for (size_t i{0}, count{in.read_size()}; i < count; ++i) {
+    const auto pos = read_position(in);
+    auto& fixture = map.fixtures[pos];
+    fixture.name = in.read_string();
+    fixture.ch = in.read_int();
+    fixture.fg = read_color(in);
+  }
+  map.frozen_actors.resize(in.read_size());
+  for (auto& actor_id : map.frozen_actors) actor_id = read_actor_id(in);
+  return map;
+}
+
+/// Write the header of a binary file, `magic` followed by FORMAT_VERSION.
+inline void write_header(Writer& out, const std::array<char, 4>& magic) {
+  out.write_bytes(std::as_bytes(std::span{magic}));
+  out.write_varint(FORMAT_VERSION);
+}
+/// Read and check the header of a binary file.  Returns a reader positioned after it.
+/// The format version is stored into `version` if given, any version up to FORMAT_VERSION is accepted.
+[[nodiscard]] inline auto read_header(
+    std::span<const std::byte> data, const std::array<char, 4>& magic, uint64_t* version = nullptr) -> Reader {
+  const auto is_match = [](char c, std::byte b) { return static_cast<std::byte>(c) == b; };
+  if (data.size() < magic.size() || !std::equal(magic.begin(), magic.end(), data.begin(), is_match)) {
+    throw DecodeError("Unexpected file type.");
+  }
+  auto in = Reader{data.subspan(magic.size())};
+  const auto file_version = in.read_varint();
+  if (file_version < 1 || file_version > FORMAT_VERSION) {
+    throw DecodeError("Unsupported save version: " + std::to_string(file_version));
+  }
+  if (version) *version = file_version;
+  return in;
+}
+
+/// Write the actors frozen in `map`, which are saved with the map instead of with the world.
+inline void write_frozen_actors(Writer& out, const World& world, const Map& map) {
+  const auto is_missing = [&world](ActorID actor_id) { return !world.actors.contains(actor_id); };
+  out.write_varint(map.frozen_actors.size() - std::ranges::count_if(map.frozen_actors, is_missing));
+  for (const auto actor_id : map.frozen_actors) {
+    if (is_missing(actor_id)) continue;  // Frozen actors are only removed from the map when it is activated.
+    write_actor_id(out, actor_id);
+    write_actor(out, world.get(actor_id));
+  }
+}
+/// Read a list of actors written by write_world_state or write_frozen_actors into `world`.
+/// Throws DecodeError if an actor has the ID of an actor already in `world`.
+inline void read_actors(Reader& in, World& world) {
+  const auto actor_count = in.read_size();
+  world.actors.reserve(world.actors.size() + actor_count);
+  for (size_t i{0}; i < actor_count; ++i) {
+    const auto actor_id = read_actor_id(in);
+    const auto [actor, inserted] = world.actors.try_emplace(actor_id, read_actor(in));
+    if (!inserted) throw DecodeError("Actor ID " + std::to_string(static_cast<uint32_t>(actor_id)) + " is taken.");
+    actor->second.id = actor_id;
+  }
+}
+
+/// Write everything in `world` except its maps.  Actors in `skip_actors` are left out.
+inline void write_world_state(Writer& out, const World& world, const std::unordered_set<ActorID>& skip_actors = {}) {
+  out.write_signed(world.turn);
+  // The engine state is only portable through its text form, so the numbers in that text are stored.
+  auto rng_text = std::stringstream{};
+  rng_text << world.rng;
+  auto rng_state = std::vector<uint64_t>{};
+  for (uint64_t value{}; rng_text >> value;) rng_state.emplace_back(value);
+  out.write_varint(rng_state.size());
+  for (const auto value : rng_state) out.write_varint(value);
+
+  out.write_varint(world.log.messages.size());
+  for (const auto& message : world.log.messages) {
+    out.write_string(message.text);
+    write_color(out, message.fg);
+    out.write_signed(message.count);
+  }
+  out.write_varint(world.schedule.size());
+  for (const auto actor_id : world.schedule) write_actor_id(out, actor_id);
+  out.write_varint(world.dormant_actors.size());
+  for (const auto actor_id : world.dormant_actors) write_actor_id(out, actor_id);
+  write_map_id(out, world.current_map_id);
+  out.write_varint(world.actors.size() - std::ranges::count_if(world.actors, [&skip_actors](const auto& it) {
+                     return skip_actors.contains(it.first);
+                   }));
+  for (const auto& [actor_id, actor] : world.actors) {
+    if (skip_actors.contains(actor_id)) continue;
+    write_actor_id(out, actor_id);
+    write_actor(out, actor);
+  }
+}
+inline void read_world_state(Reader& in, World& world) {
+  world.turn = in.read_int();
+  auto rng_text = std::stringstream{};
+  for (size_t i{0}, count{in.read_size()}; i < count; ++i) rng_text << in.read_varint() << ' ';
+  rng_text >> world.rng;
+  if (!rng_text) throw DecodeError("Invalid RNG state.");
+
+  world.log.messages.resize(in.read_size());
+  for (auto& message : world.log.messages) {
+    message.text = in.read_string();
+    message.fg = read_color(in);
+    message.count = in.read_int();
+  }
+  world.schedule.resize(in.read_size());
+  for (auto& actor_id : world.schedule) actor_id = read_actor_id(in);
+  for (size_t i{0}, count{in.read_size()}; i < count; ++i) world.dormant_actors.emplace(read_actor_id(in));
+  world.current_map_id = read_map_id(in);
+  read_actors(in, world);
+}
+
+/// Check a World which was just decoded and rebuild everything which is not saved.
+inline void finish_loading(World& world) {
+  if (!world.maps.contains(world.current_map_id)) throw DecodeError("The current map is missing.");
+  if (!world.actors.contains(ActorID{0})) throw DecodeError("The player is missing.");
+  for (auto& [map_id, map] : world.maps) map.id = map_id;
+  // Dead actors stay in the schedule until their next turn, so only actors which still exist become active.
+  for (const auto actor_id : world.schedule) {
+    if (world.actors.contains(actor_id)) world.active_actors.emplace(actor_id);
+  }
+  for (const auto actor_id : world.dormant_actors) {
+    if (!world.actors.contains(actor_id)) throw DecodeError("A dormant actor is missing.");
+    world.active_actors.emplace(actor_id);
+  }
+  reindex_actors(world);
+}
+
+/// Return `world` in the binary save format.  With a scheduler each map is encoded as a parallel task.
+[[nodiscard]] inline auto encode_world(const World& world, jobs::Scheduler* scheduler = nullptr)
+    -> std::vector<std::byte> {
+  if (!world.unloaded_maps.empty()) throw std::logic_error("Maps must be loaded before the world is encoded.");
+  auto maps = std::vector<std::pair<const MapID*, const Map*>>{};
+  for (const auto& [map_id, map] : world.maps) maps.emplace_back(&map_id, &map);
+  auto encoded_maps = std::vector<Writer>(maps.size());
+  jobs::parallel_for(scheduler, 0, static_cast<int>(maps.size()), 1, [&maps, &encoded_maps](int i) {
+    write_map(encoded_maps.at(i), *maps.at(i).second);
+  });
+
+  auto out = Writer{};
+  write_header(out, MAGIC);
+  write_world_state(out, world);
+  out.write_varint(maps.size());
+  for (size_t i{0}; i < maps.size(); ++i) {
+    write_map_id(out, *maps.at(i).first);
+    out.write_varint(encoded_maps.at(i).data().size());
+    out.write_bytes(encoded_maps.at(i).data());
+  }
+  return out.release();
+}
+
+/// Decode a World from the binary save format.  Throws DecodeError if `data` is not a valid save.
+[[nodiscard]] inline auto decode_world(std::span<const std::byte> data) -> std::unique_ptr<World> {
+  auto in = read_header(data, MAGIC);
+  auto world = std::make_unique<World>();
+  read_world_state(in, *world);
+  for (size_t i{0}, count{in.read_size()}; i < count; ++i) {
+    auto map_id = read_map_id(in);
+    auto map_in = Reader{in.read_bytes(in.read_size())};
+    world->maps[map_id] = read_map(map_in);
+  }
+  finish_loading(*world);
+  return world;
+}
+}  // namespace binary
@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string_view>
+
+#include "maptools.hpp"
+#include "pathfinding/dijkstra.hpp"
+#include "types/recording.hpp"
+#include "types/world.hpp"
+#include "world_logic.hpp"
+#include "xp.hpp"
+
+namespace bot {
+/// Plays as the player when nobody is at the keyboard.
+class Policy {
+ public:
+  virtual ~Policy() = default;
+  /// Return the next command for the player to give.  Commands which need a tile picked are not supported.
+  [[nodiscard]] virtual auto next_command(const World& world) -> replay::Command = 0;
+  /// Return the stat to improve when the player levels up.
+  [[nodiscard]] virtual auto choose_level_up(const World&) -> LevelUpStat { return LevelUpStat::constitution; }
+};
+
+/// Bumps in a random direction every turn, including waiting in place.
+class RandomWalk : public Policy {
+ public:
+  explicit RandomWalk(std::mt19937::result_type seed = 0) : rng_{seed} {}
+
+  [[nodiscard]] auto next_command(const World&) -> replay::Command override {
+    return replay::Bump{{static_cast<int>(rng_() % 3) - 1, static_cast<int>(rng_() % 3) - 1}};
+  }
+
+ private:
+  std::mt19937 rng_;  // Separate from World::rng so that the bot does not change how the world plays out.
+};
+
+/// Fights what it sees, collects items, explores the level and then takes the stairs down.
+class Explorer : public Policy {
+ public:
+  [[nodiscard]] auto next_command(const World& world) -> replay::Command override {
+    const auto& map = world.active_map();
+    const auto& player = world.active_player();
+
+    if (player.stats.hp <= player.stats.max_hp / 2) {
+      const auto& inventory = player.stats.inventory;
+      const auto potion =
+          std::ranges::find_if(inventory, [](const auto& item) { return item->get_name() == "health potion"; });
+      if (potion != inventory.end()) return replay::UseItem{static_cast<int>(potion - inventory.begin())};
+    }
+    if (map.items.contains(player.pos)) return replay::Pickup{};
+
+    // Walk down a Dijkstra map towards the nearest goal, only through tiles the player has explored.
+    auto cost = util::Array2D<int>{map.get_size()};
+    auto dist = util::Array2D<int>{map.get_size(), std::numeric_limits<int>::max()};
+    bool has_goal = false;
+    const auto add_goal = [&dist, &has_goal](Position pos) {
+      dist.at(pos) = 0;
+      has_goal = true;
+    };
+    with_indexes(map, [&](int x, int y) {
+      const auto pos = Position{x, y};
+      if (!map.explored.at(pos) || map.tiles.at(pos) != Tiles::floor) return;
+      cost.at(pos) = 1;
+      if (is_frontier(map, pos)) add_goal(pos);
+    });
+    for (const auto& [item_pos, item] : map.items) {
+      if (map.visible.at(item_pos)) add_goal(item_pos);
+    }
+    with_active_actors(world, [&](const Actor& actor) {
+      if (actor.id != player.id && map.visible.at(actor.pos)) add_goal(actor.pos);
+    });
+    if (!has_goal) {
+      // Nothing left to explore.
+      const auto stairs = find_fixture_by_name(map, "down stairs");
+      if (!stairs) return replay::Bump{};
+      if (*stairs == player.pos) return replay::UseStairs{true};
+      add_goal(*stairs);
+    }
+    pf::dijkstra2d(dist, cost);
+
+    auto best_dir = Position{0, 0};
+    auto best_dist = dist.at(player.pos);
+    for (const auto dir : NEIGHBORS) {
+      const auto next = player.pos + dir;
+      if (!dist.in_bounds(next) || dist.at(next) >= best_dist) continue;
+      best_dir = dir;
+      best_dist = dist.at(next);
+    }
+    return replay::Bump{best_dir};
+  }
+
+ private:
+  /// Return true if `pos` is next to a tile which has not been explored yet.
+  [[nodiscard]] static auto is_frontier(const Map& map, Position pos) -> bool {
+    return std::ranges::any_of(NEIGHBORS, [&map, pos](Position dir) {
+      return map.explored.in_bounds(pos + dir) && !map.explored.at(pos + dir);
+    });
+  }
+
+  static constexpr auto NEIGHBORS = std::array<Position, 8>{
+      Position{-1, -1}, Position{0, -1}, Position{1, -1}, Position{-1, 0},
+      Position{1, 0}, Position{-1, 1}, Position{0, 1}, Position{1, 1}};
+};
+
+/// Return a new policy by name, or null if there is no policy with that name.
+[[nodiscard]] inline auto make_policy(std::string_view name, std::mt19937::result_type seed = 0)
+    -> std::unique_ptr<Policy> {
+  if (name == "random") return std::make_unique<RandomWalk>(seed);
+  if (name == "explorer") return std::make_unique<Explorer>();
+  return nullptr;
+}
+}  // namespace bot
@@ -1,12 +1,16 @@
 #pragma once
 #include <fmt/core.h>
 
+#include "actor_index.hpp"
+#include "noise.hpp"
 #include "types/actor.hpp"
 #include "types/world.hpp"
 
 namespace combat {
 inline auto destroy(World& world, const Actor& target) {
+  unindex_actor(world, target);
   world.active_actors.erase(target.id);
+  world.dormant_actors.erase(target.id);
   world.actors.erase(target.id);
 }
 
@@ -37,6 +41,7 @@ inline auto calculate_damage(World&, const Actor& target, int damage) -> int {
 
 inline auto attack(World& world, Actor& self, Actor& target) {
   const auto damage = calculate_damage(world, target, self.stats.attack);
+  noise::make_noise(world, target.pos, noise::COMBAT_VOLUME);
   if (const auto& map = world.active_map(); map.visible.at(self.pos) || map.visible.at(target.pos)) {
     if (damage > 0) {
       world.log.append(fmt::format("{} attacks {} for {} hit points.", self.name, target.name, damage));
@@ -1,24 +1,38 @@
 #pragma once
+#include <algorithm>
 #include <libtcod.hpp>
 
+#include "perf_stats.hpp"
+#include "trace.hpp"
 #include "types/map.hpp"
 #include "types/position.hpp"
 
-inline auto update_fov(Map& map, Position pov) {
-  const auto [WIDTH, HEIGHT] = map.get_size();
+constexpr int FOV_RADIUS = 8;
+
+inline auto update_fov(Map& map, Position pov, int radius = FOV_RADIUS) {
+  const trace::Zone trace_zone{"update_fov"};
+  const perfstats::Timer timer{perfstats::Metric::fov};
+  map.dirty = true;
+  // Nothing beyond `radius` can be seen, so only the window around `pov` is computed.
+  std::fill(map.visible.begin(), map.visible.end(), false);
+  const auto origin = Position{std::max(0, pov.x - radius), std::max(0, pov.y - radius)};
+  const int WIDTH = std::min(map.get_width(), pov.x + radius + 1) - origin.x;
+  const int HEIGHT = std::min(map.get_height(), pov.y + radius + 1) - origin.y;
+  const auto tiles = map.tiles.subview(origin, {WIDTH, HEIGHT});
   auto fov_map = TCODMap{WIDTH, HEIGHT};
   for (int y{0}; y < HEIGHT; ++y) {
-    for (int x{0}; x < WIDTH; ++x) {
-      fov_map.setProperties(x, y, map.tiles.at({x, y}) == Tiles::floor, false);
-    }
+    const auto row = tiles.row(y);
+    for (int x{0}; x < WIDTH; ++x) fov_map.setProperties(x, y, row[x] == Tiles::floor, false);
   }
 
-  fov_map.computeFov(pov.x, pov.y, 8, true, FOV_SYMMETRIC_SHADOWCAST);
+  fov_map.computeFov(pov.x - origin.x, pov.y - origin.y, radius, true, FOV_SYMMETRIC_SHADOWCAST);
 
   for (int y{0}; y < HEIGHT; ++y) {
     for (int x{0}; x < WIDTH; ++x) {
-      map.visible.at({x, y}) = fov_map.isInFov(x, y);
-      map.explored.at({x, y}) = map.explored.at({x, y}) || map.visible.at({x, y});
+      if (!fov_map.isInFov(x, y)) continue;
+      const auto map_pos = origin + Position{x, y};
+      map.visible[map_pos] = true;
+      map.explored[map_pos] = true;
     }
   }
 }
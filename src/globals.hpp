@@ -1,4 +1,9 @@
 #pragma once
+#include <SDL3/SDL_events.h>
+
+#include <deque>
+#include <filesystem>
+#include <future>
 #include <libtcod.hpp>
 
 #include "types/state.hpp"
@@ -11,15 +16,39 @@
 // inline std::unique_ptr<state::State> g_state;
 
 // Phase 3: Additional globals
+#include "jobs.hpp"
+#include "map_export.hpp"
+#include "perf_stats.hpp"
+#include "procgen/level_params.hpp"
+#include "render_snapshot.hpp"
+#include "save_writer.hpp"
+#include "turn_arena.hpp"
 #include "types/controller.hpp"
+#include "types/recording.hpp"
 #include "types/world.hpp"
 
 // Encapsulates the entire game state
 struct GameContext {
+  jobs::Scheduler scheduler;  // Shared by anything which runs in parallel, see jobs.hpp.  First so it outlives users.
+  perfstats::Collector perf_stats;  // Timings of this context, see perf_stats.hpp.  Outlives the threads timing it.
   tcod::Console console;
   tcod::Context context;
   tcod::Console log_console;  // Optimization: Pre-allocated console for logging
   std::unique_ptr<state::State> state;
   std::unique_ptr<World> world;
   Controller controller;
+  arena::TurnArena turn_arena{scheduler};  // Allocations which only last until the turn ends, see turn_arena.hpp.
+  bool simulate_frozen_levels = false;  // Keep levels the player left running in the background.
+  procgen::LevelParams level_params;  // How new levels are generated.
+  std::filesystem::path record_path;  // Where sessions are recorded to, or empty to not record.  See replay.hpp.
+  std::unique_ptr<replay::Recording> recording;  // The session being recorded.
+  std::unique_ptr<MapExporter> map_export;  // Mirrors the active map into shared memory after each turn, if set.
+  save::SaveWriter saves;  // Writes the default save in the background, see save_writer.hpp.
+  int autosave_turns = 0;  // Save every this many turns, or never if zero.
+  bool show_memory_stats = false;  // Draw allocations by subsystem over the map, see memory_stats.hpp.
+  bool show_perf_stats = false;  // Draw timings and memory use over the map, see perf_stats.hpp.
+  std::filesystem::path trace_path;  // Where trace zones are written, or empty if tracing is off.  See trace.hpp.
+  RenderSnapshotBuffer snapshots;  // What is drawn, so that drawing never reads the World.
+  std::deque<SDL_Event> deferred_events;  // Events received while a turn was being simulated.
+  std::future<void> pending_turn;  // The turn being simulated, see simulation.hpp.  Last so it is joined first.
 };
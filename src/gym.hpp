@@ -0,0 +1,348 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "globals.hpp"
+#include "jobs.hpp"
+#include "replay.hpp"
+#include "types/recording.hpp"
+#include "world_init.hpp"
+#include "xp.hpp"
+
+/*****************************************************************************
+    A reset/step interface for training agents against the game, served over a binary protocol.
+
+    The server owns a fixed number of environments, each an independent world.  All values are little-endian.
+
+    On connecting the server sends a handshake:
+        char[4] "RLGY", u32 PROTOCOL_VERSION, u32 environment count, u32 observation width, u32 observation height.
+
+    Each request starts with a one byte opcode and a u32 count, followed by `count` fixed-size records:
+        'R' reset:  {u32 env, u32 seed}
+        'S' step:   {u32 env, u8 action, i8 x, i8 y, u8 unused}
+        'Q' quit:   no records.
+    An environment may appear at most once per request.  The environments of a request are run in parallel.
+
+    Each response starts with a u8 status.  On failure (status 1) it is followed by a u32 length and that many bytes
+    of error message.  On success (status 0) it is followed by one record per request record, in request order:
+        reset:  Observation
+        step:   f32 reward, u8 done, u8 took_turn, u8[2] unused, Observation
+
+    Step actions are ActionType values.  For `bump` and `pick_tile` x,y is relative to the player, for `use_item` x is
+    the inventory index.  Items which need a target must be followed by a `pick_tile` step.
+
+    An Observation is a header of i32 values (hp, max_hp, xp, player level, dungeon level, turn) followed by the
+    Layer planes, each observation width * height bytes in row-major order, centered on the player.
+    The reward for a step is the XP gained plus DEPTH_REWARD for each new dungeon level reached.  An environment is
+    done once the player has died and must be reset before it can step again.
+ */
+namespace gym {
+static_assert(std::endian::native == std::endian::little, "The protocol is sent in native byte order.");
+
+inline constexpr uint32_t PROTOCOL_VERSION = 1;
+inline constexpr auto MAGIC = std::array<char, 4>{'R', 'L', 'G', 'Y'};
+inline constexpr float DEPTH_REWARD = 100;
+
+enum class Op : uint8_t { reset = 'R', step = 'S', quit = 'Q' };
+
+enum class ActionType : uint8_t {
+  bump = 0,  // Move, attack or wait in direction x,y.
+  pickup,
+  use_item,
+  stairs_down,
+  stairs_up,
+  pick_tile,
+};
+
+/// The planes of an Observation.
+enum class Layer : uint8_t {
+  tiles = 0,  // 0 if unexplored or out of bounds, 1 for floor, 2 for wall.
+  visible,  // 1 if currently in view.
+  glyphs,  // The character of the actor, item or fixture in view on this tile, or 0.
+  count,
+};
+
+inline constexpr size_t OBSERVATION_HEADER_SIZE = 6 * sizeof(int32_t);
+inline constexpr size_t STEP_HEADER_SIZE = sizeof(float) + 4;
+
+#pragma pack(push, 1)
+struct ResetRecord {
+  uint32_t env;
+  uint32_t seed;
+};
+struct StepRecord {
+  uint32_t env;
+  ActionType action;
+  int8_t x;
+  int8_t y;
+  uint8_t unused;
+};
+#pragma pack(pop)
+static_assert(sizeof(ResetRecord) == 8 && sizeof(StepRecord) == 8);
+
+/// Return the command performed by a step record.
+[[nodiscard]] inline auto to_command(const StepRecord& record, Position player_pos) -> replay::Command {
+  const auto offset = Position{record.x, record.y};
+  switch (record.action) {
+    case ActionType::bump:
+      return replay::Bump{offset};
+    case ActionType::pickup:
+      return replay::Pickup{};
+    case ActionType::use_item:
+      return replay::UseItem{record.x};
+    case ActionType::stairs_down:
+      return replay::UseStairs{true};
+    case ActionType::stairs_up:
+      return replay::UseStairs{false};
+    case ActionType::pick_tile:
+      return replay::PickTile{player_pos + offset};
+  }
+  throw std::invalid_argument("Unknown action: " + std::to_string(static_cast<int>(record.action)));
+}
+
+/// The outcome of Environment::step.
+struct StepResult {
+  float reward = 0;
+  bool done = false;
+  bool took_turn = false;
+};
+
+/// A single world which is played one step at a time.
+class Environment {
+ public:
+  explicit Environment(int radius) : radius_{radius} {}
+
+  [[nodiscard]] auto get_observation_width() const noexcept -> int { return radius_ * 2 + 1; }
+  [[nodiscard]] auto get_observation_size() const noexcept -> size_t {
+    const auto width = static_cast<size_t>(get_observation_width());
+    return OBSERVATION_HEADER_SIZE + width * width * static_cast<size_t>(Layer::count);
+  }
+
+  [[nodiscard]] auto get_player_pos() const -> Position { return context_.world->active_player().pos; }
+  [[nodiscard]] auto is_done() const -> bool { return context_.world->active_player().stats.hp <= 0; }
+
+  /// Start a new world generated from `seed`.
+  void reset(std::mt19937::result_type seed) {
+    context_.world = new_world(seed, context_.level_params);
+    picking_ = nullptr;
+    deepest_level_ = context_.world->current_map_id.level;
+  }
+
+  /// Give `command` as the player.  The player levels up their constitution as soon as they can.
+  auto step(const replay::Command& command) -> StepResult {
+    if (!context_.world) throw std::logic_error("Environment was stepped before it was reset.");
+    auto result = StepResult{};
+    auto& world = *context_.world;
+    if (is_done()) {
+      result.done = true;
+      return result;
+    }
+    const int xp_before = world.active_player().stats.xp;
+    result.took_turn = replay::execute(context_, command, picking_);
+    auto& player = world.active_player();
+    result.reward += static_cast<float>(player.stats.xp - xp_before);
+    if (player.stats.hp > 0 && player.stats.xp >= next_level_xp(player.stats.level)) {
+      std::ignore = replay::execute(context_, replay::LevelUp{LevelUpStat::constitution}, picking_);
+    }
+    if (world.current_map_id.level > deepest_level_) {
+      result.reward += DEPTH_REWARD * static_cast<float>(world.current_map_id.level - deepest_level_);
+      deepest_level_ = world.current_map_id.level;
+    }
+    result.done = is_done();
+    return result;
+  }
+
+  /// Write the current Observation to `out`, which must be get_observation_size() bytes.
+  void observe(std::span<std::byte> out) const {
+    assert(out.size() == get_observation_size());
+    const auto& world = *context_.world;
+    const auto& map = world.active_map();
+    const auto& player = world.active_player();
+    const auto header = std::array<int32_t, 6>{
+        player.stats.hp,
+        player.stats.max_hp,
+        player.stats.xp,
+        player.stats.level,
+        world.current_map_id.level,
+        world.turn};
+    std::memcpy(out.data(), header.data(), OBSERVATION_HEADER_SIZE);
+
+    const int width = get_observation_width();
+    const auto plane_size = static_cast<size_t>(width * width);
+    auto* tiles = reinterpret_cast<uint8_t*>(out.data() + OBSERVATION_HEADER_SIZE);
+    auto* visible = tiles + plane_size;
+    auto* glyphs = visible + plane_size;
+    std::memset(tiles, 0, plane_size * static_cast<size_t>(Layer::count));
+    const auto origin = player.pos - Position{radius_, radius_};
+    for (int y{0}; y < width; ++y) {
+      for (int x{0}; x < width; ++x) {
+        const auto pos = origin + Position{x, y};
+        if (!map.tiles.in_bounds(pos) || !map.explored.at(pos)) continue;
+        const auto i = static_cast<size_t>(y * width + x);
+        tiles[i] = map.tiles.at(pos) == Tiles::floor ? 1 : 2;
+        if (!map.visible.at(pos)) continue;
+        visible[i] = 1;
+        glyphs[i] = get_glyph(world, map, pos);
+      }
+    }
+  }
+
+ private:
+  /// Return the character drawn on a visible tile, the same priority as update_render_snapshot.
+  [[nodiscard]] static auto get_glyph(const World& world, const Map& map, Position pos) -> uint8_t {
+    if (const auto actor = world.actor_positions.find(pos); actor != world.actor_positions.end()) {
+      return static_cast<uint8_t>(world.get(actor->second).ch);
+    }
+    if (const auto item = map.items.find(pos); item != map.items.end()) {
+      return static_cast<uint8_t>(std::get<0>(item->second->get_graphic()));
+    }
+    if (const auto fixture = map.fixtures.find(pos); fixture != map.fixtures.end()) {
+      return static_cast<uint8_t>(fixture->second.ch);
+    }
+    return 0;
+  }
+
+  int radius_;
+  GameContext context_;  // Has no scheduler workers, so everything runs on the thread stepping this environment.
+  std::unique_ptr<state::State> picking_;  // The state waiting for a pick_tile step.
+  int deepest_level_ = 1;
+};
+
+/// Serves a set of environments to one client at a time.
+class Server {
+ public:
+  Server(int env_count, int radius, jobs::Scheduler& scheduler) : scheduler_{scheduler} {
+    envs_.reserve(env_count);
+    for (int i{0}; i < env_count; ++i) envs_.emplace_back(std::make_unique<Environment>(radius));
+    // Every environment starts with a world so that stepping before a reset is not an error.
+    for (int i{0}; i < env_count; ++i) envs_.at(i)->reset(static_cast<std::mt19937::result_type>(i));
+    observation_width_ = envs_.empty() ? 0 : envs_.front()->get_observation_width();
+    observation_size_ = envs_.empty() ? 0 : envs_.front()->get_observation_size();
+  }
+
+  /// Handle requests from `in` until the client quits or disconnects.  Returns false if the client sent quit.
+  auto serve(std::FILE* in, std::FILE* out) -> bool {
+    write_value(out, MAGIC);
+    write_value(out, PROTOCOL_VERSION);
+    write_value(out, static_cast<uint32_t>(envs_.size()));
+    write_value(out, static_cast<uint32_t>(observation_width_));
+    write_value(out, static_cast<uint32_t>(observation_width_));
+    std::fflush(out);
+    while (true) {
+      auto op = Op{};
+      auto count = uint32_t{};
+      if (!read_value(in, op) || !read_value(in, count)) return true;
+      if (op == Op::quit) return false;
+      response_.clear();
+      response_.emplace_back(std::byte{0});
+      bool unknown_op = false;
+      try {
+        if (op == Op::reset) {
+          handle_reset(in, count);
+        } else if (op == Op::step) {
+          handle_step(in, count);
+        } else {
+          // The size of the records which follow is unknown, so the connection can not continue.
+          unknown_op = true;
+          throw std::runtime_error("Unknown opcode: " + std::to_string(static_cast<int>(op)));
+        }
+      } catch (const std::exception& error) {
+        if (std::feof(in)) return true;
+        const auto message = std::string{error.what()};
+        response_.assign(1, std::byte{1});
+        append_value(static_cast<uint32_t>(message.size()));
+        append_bytes(message.data(), message.size());
+      }
+      std::fwrite(response_.data(), 1, response_.size(), out);
+      if (std::fflush(out) != 0 || unknown_op) return true;
+    }
+  }
+
+ private:
+  /// Read `count` records, failing if any environment is out of range or repeated.
+  template <typename Record>
+  auto read_records(std::FILE* in, uint32_t count) -> std::vector<Record> {
+    auto records = std::vector<Record>(count);
+    if (count && std::fread(records.data(), sizeof(Record), count, in) != count) {
+      throw std::runtime_error("Truncated request.");
+    }
+    auto seen = std::vector<bool>(envs_.size());
+    for (const auto& record : records) {
+      if (record.env >= envs_.size()) throw std::out_of_range("No environment " + std::to_string(record.env));
+      if (seen.at(record.env)) throw std::invalid_argument("Environment repeated: " + std::to_string(record.env));
+      seen.at(record.env) = true;
+    }
+    return records;
+  }
+
+  void handle_reset(std::FILE* in, uint32_t count) {
+    const auto records = read_records<ResetRecord>(in, count);
+    const auto offset = response_.size();
+    response_.resize(offset + observation_size_ * count);
+    scheduler_.parallel_for(0, static_cast<int>(count), 1, [&](int i) {
+      auto& env = *envs_.at(records.at(i).env);
+      env.reset(records.at(i).seed);
+      env.observe({response_.data() + offset + observation_size_ * i, observation_size_});
+    });
+  }
+
+  void handle_step(std::FILE* in, uint32_t count) {
+    const auto records = read_records<StepRecord>(in, count);
+    const auto offset = response_.size();
+    const auto record_size = STEP_HEADER_SIZE + observation_size_;
+    response_.resize(offset + record_size * count);
+    scheduler_.parallel_for(0, static_cast<int>(count), 1, [&](int i) {
+      auto& env = *envs_.at(records.at(i).env);
+      auto* out = response_.data() + offset + record_size * i;
+      auto result = StepResult{};
+      try {
+        result = env.step(to_command(records.at(i), env.get_player_pos()));
+      } catch (const std::exception&) {
+        // An invalid action does nothing, such as a pick_tile without an item to pick for.
+        result = StepResult{.done = env.is_done()};
+      }
+      std::memcpy(out, &result.reward, sizeof(result.reward));
+      out[4] = std::byte{result.done};
+      out[5] = std::byte{result.took_turn};
+      out[6] = out[7] = std::byte{0};
+      env.observe({out + STEP_HEADER_SIZE, observation_size_});
+    });
+  }
+
+  template <typename T>
+  static auto read_value(std::FILE* in, T& value) -> bool {
+    return std::fread(&value, sizeof(T), 1, in) == 1;
+  }
+  template <typename T>
+  static void write_value(std::FILE* out, const T& value) {
+    std::fwrite(&value, sizeof(T), 1, out);
+  }
+  template <typename T>
+  void append_value(const T& value) {
+    append_bytes(&value, sizeof(T));
+  }
+  void append_bytes(const void* data, size_t size) {
+    const auto* bytes = static_cast<const std::byte*>(data);
+    response_.insert(response_.end(), bytes, bytes + size);
+  }
+
+  jobs::Scheduler& scheduler_;
+  std::vector<std::unique_ptr<Environment>> envs_;
+  int observation_width_ = 0;
+  size_t observation_size_ = 0;
+  std::vector<std::byte> response_;  // Reused between requests.
+};
+}  // namespace gym
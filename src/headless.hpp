@@ -0,0 +1,77 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "bot.hpp"
+#include "globals.hpp"
+#include "recording.hpp"
+#include "replay.hpp"
+#include "xp.hpp"
+
+/*****************************************************************************
+    Runs the game without a window, with a bot::Policy playing as the player.
+
+    Commands are performed by replay::execute, the same way as in normal play and in replays, but nothing is drawn
+    and no render snapshots are published, so this runs as fast as the simulation allows.  Commands are recorded if
+    the context is recording.
+ */
+namespace headless {
+/// The outcome of `run`.
+struct Report {
+  int turns = 0;  // Turns which were completed.
+  int failed_actions = 0;  // Commands which did not take a turn.
+  int level_ups = 0;
+  int64_t damage_taken = 0;  // Total HP the player lost, healing does not count against it.
+  bool player_died = false;
+  double seconds = 0;  // Wall time spent running turns.
+
+  [[nodiscard]] auto turns_per_second() const noexcept -> double { return seconds > 0 ? turns / seconds : 0; }
+};
+
+/// Have `policy` play `context.world` for up to `turn_count` turns or until the player dies.
+/// `on_turn` is called with the number of turns completed after each turn, including any level up.
+inline auto run(
+    GameContext& context, bot::Policy& policy, int turn_count, const std::function<void(int turns)>& on_turn = {})
+    -> Report {
+  // A policy which only gives refused commands would never finish a turn, so it is made to wait instead.
+  static constexpr int MAX_FAILED_ACTIONS_PER_TURN = 8;
+  assert(context.world);
+  auto& world = *context.world;
+  auto report = Report{};
+  auto picking = std::unique_ptr<state::State>{};  // Bots do not pick tiles, so this is ignored.
+  const auto start_time = std::chrono::steady_clock::now();
+  int failed_this_turn = 0;
+  while (report.turns < turn_count) {
+    if (world.active_player().stats.hp <= 0) {
+      report.player_died = true;
+      break;
+    }
+    const auto command =
+        failed_this_turn < MAX_FAILED_ACTIONS_PER_TURN ? policy.next_command(world) : replay::Command{replay::Bump{}};
+    replay::record(context, command);
+    const int hp_before = world.active_player().stats.hp;
+    const bool took_turn = replay::execute(context, command, picking);
+    report.damage_taken += std::max(0, hp_before - world.active_player().stats.hp);
+    if (!took_turn) {
+      ++report.failed_actions;
+      ++failed_this_turn;
+      continue;
+    }
+    failed_this_turn = 0;
+    ++report.turns;
+    const auto& player = world.active_player();
+    if (player.stats.hp > 0 && player.stats.xp >= next_level_xp(player.stats.level)) {
+      const auto level_up = replay::Command{replay::LevelUp{policy.choose_level_up(world)}};
+      replay::record(context, level_up);
+      std::ignore = replay::execute(context, level_up, picking);
+      ++report.level_ups;
+    }
+    if (on_turn) on_turn(report.turns);
+  }
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  return report;
+}
+}  // namespace headless
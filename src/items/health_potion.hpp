@@ -5,6 +5,7 @@
 #include "../combat.hpp"
 #include "../globals.hpp"
 #include "../item_tools.hpp"
+#include "../type_registry.hpp"
 #include "../types/actor.hpp"
 #include "../types/item.hpp"
 #include "../types/world.hpp"
@@ -19,4 +20,11 @@ struct HealthPotion : public Item {
     consume_discard_item(actor, this);
     return action::Success{};
   };
+
+  /// Visit the fields which are saved, see type_registry.hpp.
+  template <typename Self, typename Visitor>
+  static void visit_fields(Self& self, Visitor&& visit) {
+    visit("count", self.count);
+  }
 };
+inline const bool HEALTH_POTION_REGISTERED = get_item_types().add<HealthPotion>("HealthPotion", 1);
@@ -5,6 +5,7 @@
 #include "../globals.hpp"
 #include "../item_tools.hpp"
 #include "../states/pick_tile.hpp"
+#include "../type_registry.hpp"
 #include "../types/actor.hpp"
 #include "../types/item.hpp"
 #include "../types/world.hpp"
@@ -49,4 +50,12 @@ struct ConfusionScroll : public Item {
     context.controller.cursor = nearest_visible_enemy ? nearest_visible_enemy->pos : actor.pos;
     return action::Poll{std::make_unique<state::PickTile>(std::move(context.state), on_pick)};
   };
+
+  /// Visit the fields which are saved, see type_registry.hpp.
+  template <typename Self, typename Visitor>
+  static void visit_fields(Self& self, Visitor&& visit) {
+    visit("count", self.count);
+    visit("confuse_turns", self.confuse_turns);
+  }
 };
+inline const bool CONFUSION_SCROLL_REGISTERED = get_item_types().add<ConfusionScroll>("ConfusionScroll", 2);
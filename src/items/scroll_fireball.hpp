@@ -2,11 +2,14 @@
 
 #include <fmt/core.h>
 
+#include <memory_resource>
+
 #include "../combat.hpp"
 #include "../distance.hpp"
 #include "../globals.hpp"
 #include "../item_tools.hpp"
 #include "../states/pick_tile_aoe.hpp"
+#include "../type_registry.hpp"
 #include "../types/actor.hpp"
 #include "../types/item.hpp"
 #include "../types/world.hpp"
@@ -25,7 +28,7 @@ struct FireballScroll : public Item {
   [[nodiscard]] action::Result use_item(GameContext& context, Actor& actor) override {
     auto on_pick = [&actor, this](GameContext& ctx, Position target_pos) {
       auto& world = *ctx.world;
-      auto target_ids = std::vector<ActorID>{};
+      auto target_ids = std::pmr::vector<ActorID>{&ctx.turn_arena.local()};
       for (auto& target_id : world.active_actors) {
         if (euclidean_squared(world.get(target_id).pos - target_pos) < range_squared)
           target_ids.emplace_back(target_id);
@@ -52,4 +55,13 @@ struct FireballScroll : public Item {
     return action::Poll{
         std::make_unique<state::PickTileAreaOfEffect>(std::move(context.state), on_pick, range_squared)};
   };
+
+  /// Visit the fields which are saved, see type_registry.hpp.
+  template <typename Self, typename Visitor>
+  static void visit_fields(Self& self, Visitor&& visit) {
+    visit("count", self.count);
+    visit("range_squared", self.range_squared);
+    visit("atk_damage", self.atk_damage);
+  }
 };
+inline const bool FIREBALL_SCROLL_REGISTERED = get_item_types().add<FireballScroll>("FireballScroll", 3);
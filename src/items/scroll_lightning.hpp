@@ -5,6 +5,7 @@
 #include "../combat.hpp"
 #include "../globals.hpp"
 #include "../item_tools.hpp"
+#include "../type_registry.hpp"
 #include "../types/actor.hpp"
 #include "../types/item.hpp"
 #include "../types/world.hpp"
@@ -40,4 +41,13 @@ struct LightningScroll : public Item {
     consume_discard_item(actor, this);
     return action::Success{};
   };
+
+  /// Visit the fields which are saved, see type_registry.hpp.
+  template <typename Self, typename Visitor>
+  static void visit_fields(Self& self, Visitor&& visit) {
+    visit("count", self.count);
+    visit("range_squared", self.range_squared);
+    visit("atk_damage", self.atk_damage);
+  }
 };
+inline const bool LIGHTNING_SCROLL_REGISTERED = get_item_types().add<LightningScroll>("LightningScroll", 4);
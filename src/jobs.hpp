@@ -0,0 +1,260 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "types/ndarray.hpp"
+
+/*****************************************************************************
+    A small work-stealing task scheduler shared by the engine.
+
+    Each worker owns a deque of tasks.  A worker pops its own newest task first and steals the oldest task of another
+    queue when it runs out.  Threads which are not workers push to a shared queue and help run tasks while they wait,
+    so a Scheduler with no workers still works and simply runs everything on the waiting thread.
+
+    Determinism: the scheduler never decides what a task computes, only when and where it runs.  parallel_for splits
+    its range into chunks which depend only on the range and grain, never on the number of workers.  As long as tasks
+    write to disjoint outputs, do not draw from a shared RNG, and any results are combined by index after waiting,
+    the outcome is identical for any number of workers including zero.  The order tasks run in is not deterministic.
+ */
+namespace jobs {
+/// Return the number of workers to start, leaving one core for the thread which owns the scheduler.
+inline auto default_worker_count() -> unsigned {
+#ifdef __EMSCRIPTEN__
+  return 0;  // Not built with threads.
+#else
+  return std::max(1u, std::thread::hardware_concurrency()) - 1;
+#endif
+}
+
+/// Counts unfinished tasks so that they can be waited on.
+class WaitGroup {
+ public:
+  [[nodiscard]] auto done() const noexcept -> bool { return pending_.load(std::memory_order_acquire) == 0; }
+
+ private:
+  friend class Scheduler;
+  void set_error(std::exception_ptr error) {
+    auto lock = std::lock_guard{error_mutex_};
+    if (!error_) error_ = std::move(error);
+  }
+  std::atomic<int> pending_{0};
+  std::mutex error_mutex_;
+  std::exception_ptr error_;  // The first exception thrown by a task of this group.
+};
+
+class Scheduler {
+ public:
+  using Task = std::function<void()>;
+
+  Scheduler() { queues_.emplace_back(std::make_unique<Queue>()); }
+  Scheduler(const Scheduler&) = delete;
+  Scheduler& operator=(const Scheduler&) = delete;
+  ~Scheduler() { stop(); }
+
+  /// Start `count` worker threads.  Must not be called while tasks are queued.
+  void start(unsigned count) {
+    stop();
+    stopping_ = false;
+    for (unsigned i{0}; i < count; ++i) queues_.emplace_back(std::make_unique<Queue>());
+    for (unsigned i{0}; i < count; ++i) workers_.emplace_back([this, i]() { work(i + 1); });
+  }
+
+  /// Finish all queued tasks and join the worker threads.
+  void stop() {
+    {
+      auto lock = std::lock_guard{sleep_mutex_};
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) worker.join();
+    workers_.clear();
+    queues_.resize(1);
+  }
+
+  [[nodiscard]] auto get_worker_count() const noexcept -> unsigned { return static_cast<unsigned>(workers_.size()); }
+  /// Return the index of the calling thread, from 1 for each worker or 0 for threads which are not workers.
+  [[nodiscard]] auto get_thread_index() const noexcept -> size_t { return this_queue(); }
+
+  /// Queue `task` as part of `group`.
+  void run(WaitGroup& group, Task task) {
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+    auto& queue = *queues_.at(this_queue());
+    {
+      auto lock = std::lock_guard{queue.mutex};
+      queue.tasks.emplace_back(std::move(task), &group);
+    }
+    {
+      auto lock = std::lock_guard{sleep_mutex_};
+      ++queued_;
+    }
+    wake_.notify_one();
+  }
+
+  /// Run queued tasks on this thread until every task of `group` has finished.
+  /// Rethrows the first exception thrown by a task of `group`.
+  void wait(WaitGroup& group) {
+    const auto self = this_queue();
+    while (!group.done()) {
+      if (auto entry = take(self)) {
+        execute(*entry);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    if (group.error_) std::rethrow_exception(std::exchange(group.error_, nullptr));
+  }
+
+  /// Call `func(i)` for each `i` in [begin, end) in chunks of `grain` indexes, then wait for all of them.
+  template <typename Func>
+  void parallel_for(int begin, int end, int grain, const Func& func) {
+    assert(grain > 0);
+    auto group = WaitGroup{};
+    for (int chunk{begin}; chunk < end; chunk += grain) {
+      run(group, [&func, chunk, chunk_end = std::min(end, chunk + grain)]() {
+        for (int i{chunk}; i < chunk_end; ++i) func(i);
+      });
+    }
+    wait(group);
+  }
+
+ private:
+  using Entry = std::pair<Task, WaitGroup*>;
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Entry> tasks;
+  };
+
+  /// Return the queue index for the current thread, 0 is shared by any thread which is not a worker.
+  auto this_queue() const noexcept -> size_t { return current_scheduler_ == this ? current_queue_ : 0; }
+
+  /// Pop the newest task from queue `self`, or steal the oldest task from another queue.
+  auto take(size_t self) -> std::optional<Entry> {
+    for (size_t offset{0}; offset < queues_.size(); ++offset) {
+      auto& queue = *queues_.at((self + offset) % queues_.size());
+      auto lock = std::lock_guard{queue.mutex};
+      if (queue.tasks.empty()) continue;
+      auto entry = offset == 0 ? std::move(queue.tasks.back()) : std::move(queue.tasks.front());
+      offset == 0 ? queue.tasks.pop_back() : queue.tasks.pop_front();
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      return entry;
+    }
+    return std::nullopt;
+  }
+
+  static void execute(Entry& entry) {
+    auto& [task, group] = entry;
+    try {
+      task();
+    } catch (...) {
+      group->set_error(std::current_exception());
+    }
+    group->pending_.fetch_sub(1, std::memory_order_acq_rel);
+  }
+
+  void work(size_t self) {
+    current_scheduler_ = this;
+    current_queue_ = self;
+    while (true) {
+      if (auto entry = take(self)) {
+        execute(*entry);
+        continue;
+      }
+      auto lock = std::unique_lock{sleep_mutex_};
+      wake_.wait(lock, [this]() { return stopping_ || queued_.load() > 0; });
+      if (stopping_ && queued_.load() == 0) return;
+    }
+  }
+
+  static inline thread_local const Scheduler* current_scheduler_ = nullptr;
+  static inline thread_local size_t current_queue_ = 0;
+
+  std::vector<std::unique_ptr<Queue>> queues_;  // Index 0 is shared, the rest belong to one worker each.
+  std::vector<std::thread> workers_;
+  std::atomic<int> queued_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;  // Guarded by sleep_mutex_.
+};
+
+/// Call `func(i)` for each `i` in [begin, end).  Runs serially when `scheduler` is null.
+template <typename Func>
+inline void parallel_for(Scheduler* scheduler, int begin, int end, int grain, const Func& func) {
+  if (!scheduler) {
+    for (int i{begin}; i < end; ++i) func(i);
+    return;
+  }
+  scheduler->parallel_for(begin, end, grain, func);
+}
+
+/// Call `func(y)` for each row of `array`.  Runs serially when `scheduler` is null.
+template <typename T, typename Func>
+inline void parallel_for_rows(Scheduler* scheduler, const util::Array2D<T>& array, const Func& func, int grain = 8) {
+  parallel_for(scheduler, 0, array.get_height(), grain, func);
+}
+
+/// A set of tasks with dependencies between them.  Each task runs once all of its dependencies have finished.
+class TaskGraph {
+ public:
+  using NodeID = size_t;
+
+  /// Add a task which runs after `dependencies`.  Dependencies must already be in this graph, so cycles are impossible.
+  auto add(Scheduler::Task task, std::initializer_list<NodeID> dependencies = {}) -> NodeID {
+    return add(std::move(task), std::span<const NodeID>{dependencies.begin(), dependencies.size()});
+  }
+  auto add(Scheduler::Task task, std::span<const NodeID> dependencies) -> NodeID {
+    const auto id = nodes_.size();
+    auto& node = nodes_.emplace_back();
+    node.task = std::move(task);
+    for (const auto dependency : dependencies) {
+      assert(dependency < id);
+      nodes_.at(dependency).dependents.emplace_back(id);
+      ++node.dependency_count;
+    }
+    return id;
+  }
+
+  /// Run every task of this graph and wait for them to finish.
+  void run(Scheduler& scheduler) {
+    for (auto& node : nodes_) node.remaining.store(node.dependency_count);
+    auto group = WaitGroup{};
+    for (NodeID id{0}; id < nodes_.size(); ++id) {
+      if (nodes_.at(id).dependency_count == 0) schedule(scheduler, group, id);
+    }
+    scheduler.wait(group);
+  }
+
+ private:
+  struct Node {
+    Scheduler::Task task;
+    std::vector<NodeID> dependents;
+    int dependency_count = 0;
+    std::atomic<int> remaining{0};
+  };
+
+  void schedule(Scheduler& scheduler, WaitGroup& group, NodeID id) {
+    scheduler.run(group, [this, &scheduler, &group, id]() {
+      auto& node = nodes_.at(id);
+      node.task();
+      for (const auto dependent : node.dependents) {
+        if (nodes_.at(dependent).remaining.fetch_sub(1) == 1) schedule(scheduler, group, dependent);
+      }
+    });
+  }
+
+  std::deque<Node> nodes_;  // A deque since nodes can not be moved.
+};
+}  // namespace jobs
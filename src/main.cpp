@@ -7,11 +7,14 @@
 #include <iostream>
 #include <libtcod.hpp>
 #include <memory>
+#include <string_view>
 #include <variant>
 
 // Phase 1: Core types
 #include "constants.hpp"
 #include "errors.hpp"
+#include "memory_stats_hooks.hpp"
+#include "perf_stats.hpp"
 #include "types/position.hpp"
 #include "types/stats.hpp"
 
@@ -32,7 +35,10 @@
 #include "states/levelup.hpp"
 
 // Phase 6: Serialization
+#include "replay.hpp"
 #include "serialization.hpp"
+#include "simulation.hpp"
+#include "trace.hpp"
 
 /// Return the data directory.
 auto get_data_dir() -> std::filesystem::path {
@@ -47,63 +53,131 @@ auto get_data_dir() -> std::filesystem::path {
   return root_directory / "data";
 };
 
-// Called every frame - render current state
-SDL_AppResult SDL_AppIterate(void* appstate) {
-  auto* app = static_cast<GameContext*>(appstate);
-  app->console.clear();
-  if (app->state) {
-    app->state->on_draw(*app);
+/// Report the saves which finished writing since the last call.
+static void report_saves(GameContext& app) {
+  for (const auto& result : app.saves.poll()) {
+    if (result.error.empty()) {
+      std::cout << "Game saved.\n";
+    } else {
+      std::cerr << "Failed to save world:\n" << result.error << "\n";
+    }
   }
-  app->context.present(app->console);
-  return SDL_APP_CONTINUE;
 }
 
-// Handle events - delegate to current state
-SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event) {
-  auto* app = static_cast<GameContext*>(appstate);
-  if (!app->state) return SDL_APP_CONTINUE;
+/// Save the World, if any, and wait until it is written.
+static void save_before_quit(GameContext& app) {
+  if (app.world) save::save_in_background(app.saves, *app.world, &app.scheduler);
+  app.saves.wait();
+  report_saves(app);
+}
+
+/// Show the outcome of a finished turn.
+static void after_turn(GameContext& app) {
+  const bool alive = app.world->active_player().stats.hp > 0;
+  if (alive && app.autosave_turns > 0 && app.world->turn % app.autosave_turns == 0) {
+    save::save_in_background(app.saves, *app.world, &app.scheduler);  // Reported by report_saves once written.
+  }
+  // Check for level up
+  if (app.world->active_player().stats.xp >= next_level_xp(app.world->active_player().stats.level)) {
+    app.state = std::make_unique<state::LevelUp>(app);
+  } else {
+    // Optimization: Keep the current InGame state active.
+    // app.state = std::make_unique<state::InGame>();
+  }
+}
+
+/// Pass an event to the current state and handle state transitions.
+static SDL_AppResult handle_event(GameContext& app, SDL_Event& event) {
+  if (!app.state) return SDL_APP_CONTINUE;
 
   // Let the current state handle the event and handle state transitions
-  if (auto result = app->state->on_event(*app, *event); std::holds_alternative<state::Change>(result)) {
-    app->state = std::move(std::get<state::Change>(result).new_state);
+  if (auto result = app.state->on_event(app, event); std::holds_alternative<state::Change>(result)) {
+    app.state = std::move(std::get<state::Change>(result).new_state);
   } else if (std::holds_alternative<state::Quit>(result)) {
-    if (app->world) save_world(*app->world);
+    replay::end_recording(app);
+    save_before_quit(app);
     return SDL_APP_SUCCESS;
   } else if (std::holds_alternative<state::EndTurn>(result)) {
     // Phase 4: Handle enemy turns after player action
-    app->controller.cursor = std::nullopt;
-
-    if (app->world && app->world->active_player().stats.hp > 0) {
-      auto& world = *app->world;
-      update_fov(world.active_map(), world.active_player().pos);
-      enemy_turn(*app);
-
-      // Check for level up
-      if (app->world->active_player().stats.xp >= next_level_xp(app->world->active_player().stats.level)) {
-        app->state = std::make_unique<state::LevelUp>(*app);
-      } else {
-        // Optimization: Keep the current InGame state active.
-        // app->state = std::make_unique<state::InGame>();
-      }
-    } else if (app->world && app->world->active_player().stats.hp <= 0) {
+    app.controller.cursor = std::nullopt;
+
+    if (app.world && app.world->active_player().stats.hp > 0) {
+      start_turn(app);  // The outcome is handled by after_turn once the turn finishes.
+    } else if (app.world && app.world->active_player().stats.hp <= 0) {
       // Player died
-      app->state = std::make_unique<state::Dead>();
+      app.state = std::make_unique<state::Dead>();
     }
   } else if (std::holds_alternative<state::Reset>(result)) {
     // Reset state (e.g. after LevelUp) -> Go back to InGame usually or stick to current?
     // LevelUp returns Reset when done.
-    app->state = std::make_unique<state::InGame>();
+    app.state = std::make_unique<state::InGame>();
   }
 
   // Also handle SDL_EVENT_QUIT
-  if (event->type == SDL_EVENT_QUIT) {
-    if (app->world) save_world(*app->world);
+  if (event.type == SDL_EVENT_QUIT) {
+    replay::end_recording(app);
+    save_before_quit(app);
     return SDL_APP_SUCCESS;
   }
 
+  if (!app.pending_turn.valid()) {
+    // Events can change the World, a running turn publishes its own snapshot when it finishes.
+    if (app.world) {
+      app.snapshots.publish(*app.world);
+      if (app.map_export) app.map_export->publish(*app.world);
+    } else {
+      app.snapshots.clear();
+    }
+  }
+  return SDL_APP_CONTINUE;
+}
+
+// Called every frame - render current state
+SDL_AppResult SDL_AppIterate(void* appstate) {
+  const trace::Zone trace_zone{"SDL_AppIterate"};
+  auto* app = static_cast<GameContext*>(appstate);
+  const perfstats::Scope perf_scope{app->perf_stats};
+  report_saves(*app);
+  if (!is_turn_running(*app) && finish_turn(*app)) {
+    after_turn(*app);
+    app->snapshots.publish(*app->world);
+    // Catch up on input received during the turn, stopping if that input starts another turn.
+    while (!app->deferred_events.empty() && !app->pending_turn.valid()) {
+      auto event = app->deferred_events.front();
+      app->deferred_events.pop_front();
+      if (const auto result = handle_event(*app, event); result != SDL_APP_CONTINUE) return result;
+    }
+  }
+
+  // Drawing only reads the latest render snapshot, so frames continue while a turn is being simulated.
+  {
+    const perfstats::Timer timer{perfstats::Metric::frame};  // Not counting the wait for vsync in `present`.
+    app->console.clear();
+    if (app->state) {
+      app->state->on_draw(*app);
+    }
+  }
+  app->context.present(app->console);
+  memstats::end_window(memstats::Window::frame);
+  perfstats::end_window(perfstats::Window::frame);
   return SDL_APP_CONTINUE;
 }
 
+// Handle events - delegate to current state
+SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event) {
+  const trace::Zone trace_zone{"SDL_AppEvent"};
+  auto* app = static_cast<GameContext*>(appstate);
+  const perfstats::Scope perf_scope{app->perf_stats};
+  if (app->pending_turn.valid()) {
+    if (event->type != SDL_EVENT_QUIT) {
+      app->deferred_events.push_back(*event);  // Handled once the turn is finished.
+      return SDL_APP_CONTINUE;
+    }
+    finish_turn(*app);  // The World must be saved after the turn is finished.
+  }
+  return handle_event(*app, *event);
+}
+
 // Main entry point
 SDL_AppResult SDL_AppInit(void** appstate, int argc, char** argv) {
   auto params = TCOD_ContextParams{};
@@ -123,7 +197,20 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char** argv) {
   app->console = tcod::Console{constants::CONSOLE_WIDTH, constants::CONSOLE_HEIGHT};
   params.console = app->console.get();
 
+  for (int i{1}; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    if (arg == "--simulate-frozen-levels") app->simulate_frozen_levels = true;
+    if (arg == "--record" && i + 1 < argc) app->record_path = argv[++i];
+    if (arg == "--autosave" && i + 1 < argc) app->autosave_turns = std::atoi(argv[++i]);
+    if (arg == "--trace" && i + 1 < argc) app->trace_path = argv[++i];
+    if (arg == "--export-maps" && i + 1 < argc) {
+      app->map_export = std::make_unique<MapExporter>(argv[++i], constants::MAP_WIDTH, constants::MAP_HEIGHT);
+    }
+  }
+
   app->context = tcod::Context(params);
+  app->scheduler.start(jobs::default_worker_count());
+  if (!app->trace_path.empty()) trace::enable();
   app->state = std::make_unique<state::MainMenu>();
 
   *appstate = app.release();
@@ -135,4 +222,5 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char** argv) {
 void SDL_AppQuit(void* appstate, SDL_AppResult) {
   std::cout << "Shutting down...\n";
   auto app = std::unique_ptr<GameContext>(static_cast<GameContext*>(appstate));
+  if (!app->trace_path.empty()) trace::write_chrome_trace(app->trace_path);
 }
@@ -0,0 +1,190 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <thread>
+
+#include "mapped_file.hpp"
+#include "types/map.hpp"
+#include "types/world.hpp"
+
+/*****************************************************************************
+    Export of the active map's layers into a memory-mapped file, for analytics and training tools.
+
+    The file starts with a MapExportHeader followed by the layers at the offsets given in the header:
+        tiles     int32 per tile, the Tiles enum values copied directly from Map::tiles.
+        explored  uint8 per tile.
+        visible   uint8 per tile.
+        actors    MapExportActor per active actor, actor_count of them.
+    Layers are width * height in row-major order.  Maps larger than the capacity given when the file was created are
+    clipped to the top-left corner, `map_width` and `map_height` give the full size.  Likewise only the first
+    `actor_capacity` actors are exported, `total_actor_count` gives how many were active.
+
+    The header's `sequence` is a sequence lock.  It is odd while the exporter is writing and increases by two for each
+    export.  A reader loads the sequence with acquire ordering, retries if it is odd, copies what it needs, issues an
+    acquire fence, then reloads the sequence and retries if it changed.  MapExportReader does this for C++ readers.
+    Readers should yield between retries, since the exporter may be waiting for the same core.
+ */
+struct MapExportHeader {
+  static constexpr auto MAGIC = std::array<char, 8>{'R', 'L', 'M', 'A', 'P', 'E', 'X', '\0'};
+  static constexpr uint32_t VERSION = 2;
+
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t header_size;  // sizeof(MapExportHeader).
+  uint64_t sequence;  // Only accessed atomically.
+  uint32_t tile_capacity;  // The most tiles each layer can hold.
+  uint32_t actor_capacity;  // The most actors which can be exported.
+  uint64_t tiles_offset;  // Byte offsets of each layer from the start of the file.
+  uint64_t explored_offset;
+  uint64_t visible_offset;
+  uint64_t actors_offset;
+  int32_t width;  // The size of the exported layers.
+  int32_t height;
+  int32_t map_width;  // The size of the whole map.
+  int32_t map_height;
+  int32_t level;  // MapID::level of the exported map.
+  int32_t turn;  // World::turn when exported.
+  uint32_t actor_count;  // The number of actors exported, at most actor_capacity.
+  uint32_t total_actor_count;  // The number of active actors, including any which did not fit.
+};
+static_assert(offsetof(MapExportHeader, sequence) % alignof(uint64_t) == 0);
+static_assert(sizeof(MapExportHeader) % 8 == 0);
+
+struct MapExportActor {
+  int32_t x;
+  int32_t y;
+  uint32_t id;  // The ActorID.
+  int32_t ch;
+  int32_t hp;
+  int32_t max_hp;
+};
+static_assert(sizeof(Tiles) == sizeof(int32_t), "Tiles are copied directly into the export.");
+
+/// Writes the active map of a World into a shared memory-mapped file.  Only one thread may export at a time.
+class MapExporter {
+ public:
+  /// Create the export file at `path` with space for maps of up to `max_width` by `max_height` tiles.
+  MapExporter(const std::filesystem::path& path, int max_width, int max_height, uint32_t max_actors = 4096) {
+    const auto tile_capacity = static_cast<uint64_t>(max_width) * static_cast<uint64_t>(max_height);
+    auto header = MapExportHeader{};
+    header.magic = MapExportHeader::MAGIC;
+    header.version = MapExportHeader::VERSION;
+    header.header_size = sizeof(MapExportHeader);
+    header.tile_capacity = static_cast<uint32_t>(tile_capacity);
+    header.actor_capacity = max_actors;
+    header.tiles_offset = sizeof(MapExportHeader);
+    header.explored_offset = align(header.tiles_offset + tile_capacity * sizeof(int32_t));
+    header.visible_offset = align(header.explored_offset + tile_capacity);
+    header.actors_offset = align(header.visible_offset + tile_capacity);
+    file_ = MappedFile::create(path, header.actors_offset + max_actors * sizeof(MapExportActor));
+    max_width_ = max_width;
+    max_height_ = max_height;
+    std::memcpy(file_.data(), &header, sizeof(header));
+  }
+
+  /// Export the active map and actors of `world`.
+  void publish(const World& world) {
+    const auto& map = world.active_map();
+    auto& header = get_header();
+    auto sequence = std::atomic_ref<uint64_t>{header.sequence};
+    const auto start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const int width = std::min(map.get_width(), max_width_);
+    const int height = std::min(map.get_height(), max_height_);
+    header.width = width;
+    header.height = height;
+    header.map_width = map.get_width();
+    header.map_height = map.get_height();
+    header.level = map.id.level;
+    header.turn = world.turn;
+    auto* tiles = file_.data() + header.tiles_offset;
+    auto* explored = reinterpret_cast<uint8_t*>(file_.data() + header.explored_offset);
+    auto* visible = reinterpret_cast<uint8_t*>(file_.data() + header.visible_offset);
+    const auto& tiles_data = map.tiles.get_container();
+    if (width == map.get_width()) {
+      std::memcpy(tiles, tiles_data.data(), sizeof(Tiles) * width * height);  // The common case, one contiguous copy.
+    } else {
+      for (int y{0}; y < height; ++y) {
+        std::memcpy(tiles + sizeof(Tiles) * y * width, tiles_data.data() + y * map.get_width(), sizeof(Tiles) * width);
+      }
+    }
+    // std::vector<bool> is bit-packed, so the flags are expanded to bytes instead of copied.
+    for (int y{0}; y < height; ++y) {
+      for (int x{0}; x < width; ++x) {
+        explored[y * width + x] = map.explored.at({x, y});
+        visible[y * width + x] = map.visible.at({x, y});
+      }
+    }
+    auto* actors = reinterpret_cast<MapExportActor*>(file_.data() + header.actors_offset);
+    uint32_t actor_count = 0;
+    for (const auto actor_id : world.active_actors) {
+      if (actor_count >= header.actor_capacity) break;  // Truncated, see `total_actor_count`.
+      const auto& actor = world.get(actor_id);
+      actors[actor_count++] = MapExportActor{
+          actor.pos.x,
+          actor.pos.y,
+          static_cast<uint32_t>(actor.id),
+          actor.ch,
+          actor.stats.hp,
+          actor.stats.max_hp};
+    }
+    header.actor_count = actor_count;
+    header.total_actor_count = static_cast<uint32_t>(world.active_actors.size());
+
+    sequence.store(start + 2, std::memory_order_release);
+  }
+
+ private:
+  [[nodiscard]] static constexpr auto align(uint64_t offset) noexcept -> uint64_t { return (offset + 63) / 64 * 64; }
+  [[nodiscard]] auto get_header() noexcept -> MapExportHeader& {
+    return *reinterpret_cast<MapExportHeader*>(file_.data());
+  }
+
+  MappedFile file_;
+  int max_width_ = 0;
+  int max_height_ = 0;
+};
+
+/// Reads consistent exports from a file written by MapExporter, possibly in another process.
+class MapExportReader {
+ public:
+  explicit MapExportReader(const std::filesystem::path& path) : file_{MappedFile::open_readonly(path)} {
+    if (file_.size() < sizeof(MapExportHeader) || get_header().magic != MapExportHeader::MAGIC) {
+      throw std::runtime_error("Not a map export: " + path.string());
+    }
+    if (get_header().version != MapExportHeader::VERSION) throw std::runtime_error("Unsupported map export version.");
+  }
+
+  /// Call `read(header, file_data)` on a consistent export, retrying until one is read.
+  /// `read` must only copy from the export since it may see a partial write before it is retried.
+  /// Returns the sequence number of the export which was read.
+  template <typename Func>
+  auto read(const Func& read) const -> uint64_t {
+    auto sequence = std::atomic_ref<uint64_t>{const_cast<uint64_t&>(get_header().sequence)};
+    while (true) {
+      const auto start = sequence.load(std::memory_order_acquire);
+      if (start % 2 == 0) {
+        read(get_header(), std::span<const std::byte>{file_.data(), file_.size()});
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == start) return start;
+      }
+      std::this_thread::yield();  // The export is being written, let the exporter finish.
+    }
+  }
+
+ private:
+  [[nodiscard]] auto get_header() const noexcept -> const MapExportHeader& {
+    return *reinterpret_cast<const MapExportHeader*>(file_.data());
+  }
+
+  MappedFile file_;
+};
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// A file mapped into memory and shared with any other process which maps it.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept { swap(other); }
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    MappedFile{std::move(other)}.swap(*this);
+    return *this;
+  }
+  ~MappedFile() { close(); }
+
+  /// Create or resize the file at `path` to `size` bytes and map it for reading and writing.
+  [[nodiscard]] static auto create(const std::filesystem::path& path, size_t size) -> MappedFile {
+    auto file = MappedFile{};
+    file.open(path, size, true);
+    return file;
+  }
+  /// Map all of an existing file at `path` for reading.
+  [[nodiscard]] static auto open_readonly(const std::filesystem::path& path) -> MappedFile {
+    auto file = MappedFile{};
+    file.open(path, 0, false);
+    return file;
+  }
+
+  [[nodiscard]] auto data() const noexcept -> std::byte* { return data_; }
+  [[nodiscard]] auto size() const noexcept -> size_t { return size_; }
+
+ private:
+  void swap(MappedFile& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+#ifdef _WIN32
+    std::swap(file_, other.file_);
+    std::swap(mapping_, other.mapping_);
+#endif
+  }
+
+#ifdef _WIN32
+  void open(const std::filesystem::path& path, size_t size, bool writable) {
+    const auto fail = [](const char* what) {
+      throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), what);
+    };
+    file_ = CreateFileW(
+        path.c_str(),
+        writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        writable ? OPEN_ALWAYS : OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) fail("Could not open file to map");
+    if (!writable) {
+      auto file_size = LARGE_INTEGER{};
+      if (!GetFileSizeEx(file_, &file_size)) fail("Could not get size of file to map");
+      size = static_cast<size_t>(file_size.QuadPart);
+    }
+    const auto size64 = static_cast<unsigned long long>(size);
+    mapping_ = CreateFileMappingW(
+        file_,
+        nullptr,
+        writable ? PAGE_READWRITE : PAGE_READONLY,
+        static_cast<DWORD>(size64 >> 32),
+        static_cast<DWORD>(size64),
+        nullptr);
+    if (!mapping_) fail("Could not create file mapping");
+    data_ = static_cast<std::byte*>(MapViewOfFile(mapping_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size));
+    if (!data_) fail("Could not map file");
+    size_ = size;
+  }
+  void close() noexcept {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+  }
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  void open(const std::filesystem::path& path, size_t size, bool writable) {
+    const auto fail = [](const char* what) { throw std::system_error(errno, std::generic_category(), what); };
+    const int fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fd < 0) fail("Could not open file to map");
+    struct stat status {};
+    if (!writable && ::fstat(fd, &status) == 0) size = static_cast<size_t>(status.st_size);
+    if (writable && ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      ::close(fd);
+      fail("Could not resize file to map");
+    }
+    void* data = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // The mapping keeps the file open.
+    if (data == MAP_FAILED) fail("Could not map file");
+    data_ = static_cast<std::byte*>(data);
+    size_ = size;
+  }
+  void close() noexcept {
+    if (data_) ::munmap(data_, size_);
+    data_ = nullptr;
+  }
+#endif
+
+  std::byte* data_ = nullptr;
+  size_t size_ = 0;
+};
@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <utility>
+
+/*****************************************************************************
+    Allocation accounting by subsystem.
+
+    Builds configured with ALLOCATION_STATS replace the global operator new and delete, see memory_stats_hooks.hpp,
+    and charge every allocation to the subsystem of the innermost Scope on the allocating thread.  Memory is charged
+    to the subsystem which allocated it until it is freed, wherever that happens.
+
+    Counters are read in windows: `end_window(Window::turn)` is called when each turn ends and
+    `end_window(Window::frame)` after each frame is drawn, returning what was allocated since that window last ended.
+    Windows cover allocations from every thread, so a turn simulated while frames are drawn also counts that
+    rendering under Subsystem::rendering.
+
+    Without ALLOCATION_STATS scopes compile to nothing and every report is zero.
+ */
+namespace memstats {
+#ifdef ALLOCATION_STATS
+inline constexpr bool ENABLED = true;
+#else
+inline constexpr bool ENABLED = false;
+#endif
+
+/// What allocations are charged to.  `other` is anything outside of a Scope.
+enum class Subsystem : uint8_t { other, procgen, ai, pathfinding, serialization, rendering, message_log };
+inline constexpr size_t SUBSYSTEM_COUNT = 7;
+inline constexpr auto SUBSYSTEM_NAMES = std::array<std::string_view, SUBSYSTEM_COUNT>{
+    "other", "procgen", "ai", "pathfinding", "serialization", "rendering", "message log"};
+
+/// Independent intervals which counters are reported over.
+enum class Window : uint8_t { turn, frame };
+inline constexpr size_t WINDOW_COUNT = 2;
+
+/// Allocations charged to one subsystem over one window.
+struct Counters {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;  // Total bytes allocated, including memory freed again within the window.
+  int64_t peak_bytes = 0;  // The most bytes held at once during the window, counting memory allocated before it.
+};
+/// Counters for every subsystem, indexed by Subsystem.
+using Report = std::array<Counters, SUBSYSTEM_COUNT>;
+
+/// Return the total of every subsystem in `report`.  The peak is the sum of the subsystem peaks, an upper bound.
+[[nodiscard]] inline auto get_total(const Report& report) noexcept -> Counters {
+  auto total = Counters{};
+  for (const auto& it : report) {
+    total.allocations += it.allocations;
+    total.bytes += it.bytes;
+    total.peak_bytes += it.peak_bytes;
+  }
+  return total;
+}
+
+namespace detail {
+/// Running counters of one subsystem, updated by every thread.
+struct alignas(64) Slot {
+  std::atomic<uint64_t> allocations = 0;
+  std::atomic<uint64_t> bytes = 0;
+  std::atomic<int64_t> live_bytes = 0;
+  std::array<std::atomic<int64_t>, WINDOW_COUNT> peak_bytes = {};
+};
+inline std::array<Slot, SUBSYSTEM_COUNT> slots;
+inline thread_local Subsystem current = Subsystem::other;
+
+/// The totals when each window last ended and what each window reported then.
+struct Windows {
+  std::mutex mutex;
+  std::array<Report, WINDOW_COUNT> start = {};
+  std::array<Report, WINDOW_COUNT> last = {};
+};
+inline auto get_windows() -> Windows& {
+  static auto windows = Windows{};
+  return windows;
+}
+
+inline void on_allocate(Subsystem subsystem, size_t size) noexcept {
+  auto& slot = slots[static_cast<size_t>(subsystem)];
+  slot.allocations.fetch_add(1, std::memory_order_relaxed);
+  slot.bytes.fetch_add(size, std::memory_order_relaxed);
+  const auto live = slot.live_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) +
+                    static_cast<int64_t>(size);
+  for (auto& peak : slot.peak_bytes) {
+    auto previous = peak.load(std::memory_order_relaxed);
+    while (previous < live && !peak.compare_exchange_weak(previous, live, std::memory_order_relaxed)) {}
+  }
+}
+inline void on_free(Subsystem subsystem, size_t size) noexcept {
+  slots[static_cast<size_t>(subsystem)].live_bytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
+}  // namespace detail
+
+/// Charge allocations on this thread to `subsystem` until destroyed.  Scopes nest, the innermost one wins.
+class Scope {
+ public:
+#ifdef ALLOCATION_STATS
+  explicit Scope(Subsystem subsystem) noexcept : previous_{std::exchange(detail::current, subsystem)} {}
+  ~Scope() { detail::current = previous_; }
+#else
+  explicit Scope(Subsystem) noexcept {}
+#endif
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+#ifdef ALLOCATION_STATS
+  Subsystem previous_;
+#endif
+};
+
+/// End `window`, returning what was allocated since it last ended.  The result is also kept for `get_last`.
+inline auto end_window(Window window) -> Report {
+  auto& windows = detail::get_windows();
+  auto lock = std::lock_guard{windows.mutex};
+  auto& start = windows.start[static_cast<size_t>(window)];
+  auto report = Report{};
+  for (size_t i{0}; i < SUBSYSTEM_COUNT; ++i) {
+    auto& slot = detail::slots[i];
+    const auto allocations = slot.allocations.load(std::memory_order_relaxed);
+    const auto bytes = slot.bytes.load(std::memory_order_relaxed);
+    const auto live = slot.live_bytes.load(std::memory_order_relaxed);
+    auto& peak = slot.peak_bytes[static_cast<size_t>(window)];
+    report[i] = {allocations - start[i].allocations, bytes - start[i].bytes, std::max(peak.exchange(live), live)};
+    start[i] = {allocations, bytes, 0};
+  }
+  return windows.last[static_cast<size_t>(window)] = report;
+}
+
+/// Return what `window` reported when it last ended.
+[[nodiscard]] inline auto get_last(Window window) -> Report {
+  auto& windows = detail::get_windows();
+  auto lock = std::lock_guard{windows.mutex};
+  return windows.last[static_cast<size_t>(window)];
+}
+}  // namespace memstats
@@ -0,0 +1,88 @@
+#pragma once
+/*****************************************************************************
+    Replacements of the global operator new and delete which feed memory_stats.hpp.
+
+    Include this in the source file with `main` of each program which reports allocations, and nowhere else.  It does
+    nothing unless the build defines ALLOCATION_STATS.  Each block is prefixed with a header holding what it was
+    charged to, so frees are charged back to the subsystem which allocated them.
+ */
+#ifdef ALLOCATION_STATS
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "memory_stats.hpp"
+
+namespace memstats::detail {
+struct Header {
+  void* block;  // What malloc returned.
+  size_t size;
+  Subsystem subsystem;
+};
+
+inline auto allocate(size_t size, size_t alignment) noexcept -> void* {
+  alignment = std::max(alignment, alignof(Header));
+  auto* block = std::malloc(sizeof(Header) + alignment + size);
+  if (!block) return nullptr;
+  const auto address = reinterpret_cast<uintptr_t>(block) + sizeof(Header);
+  auto* data = reinterpret_cast<void*>((address + alignment - 1) / alignment * alignment);
+  auto* header = static_cast<Header*>(data) - 1;
+  *header = Header{block, size, current};
+  on_allocate(header->subsystem, size);
+  return data;
+}
+inline auto allocate_or_throw(size_t size, size_t alignment) -> void* {
+  if (auto* data = allocate(size, alignment)) return data;
+  throw std::bad_alloc{};
+}
+inline void deallocate(void* data) noexcept {
+  if (!data) return;
+  const auto& header = *(static_cast<Header*>(data) - 1);
+  on_free(header.subsystem, header.size);
+  std::free(header.block);
+}
+}  // namespace memstats::detail
+
+void* operator new(size_t size) {
+  return memstats::detail::allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new[](size_t size) {
+  return memstats::detail::allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+  return memstats::detail::allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return memstats::detail::allocate_or_throw(size, static_cast<size_t>(alignment));
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return memstats::detail::allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return memstats::detail::allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return memstats::detail::allocate(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return memstats::detail::allocate(size, static_cast<size_t>(alignment));
+}
+void operator delete(void* data) noexcept { memstats::detail::deallocate(data); }
+void operator delete[](void* data) noexcept { memstats::detail::deallocate(data); }
+void operator delete(void* data, size_t) noexcept { memstats::detail::deallocate(data); }
+void operator delete[](void* data, size_t) noexcept { memstats::detail::deallocate(data); }
+void operator delete(void* data, std::align_val_t) noexcept { memstats::detail::deallocate(data); }
+void operator delete[](void* data, std::align_val_t) noexcept { memstats::detail::deallocate(data); }
+void operator delete(void* data, size_t, std::align_val_t) noexcept { memstats::detail::deallocate(data); }
+void operator delete[](void* data, size_t, std::align_val_t) noexcept { memstats::detail::deallocate(data); }
+void operator delete(void* data, const std::nothrow_t&) noexcept { memstats::detail::deallocate(data); }
+void operator delete[](void* data, const std::nothrow_t&) noexcept { memstats::detail::deallocate(data); }
+void operator delete(void* data, std::align_val_t, const std::nothrow_t&) noexcept {
+  memstats::detail::deallocate(data);
+}
+void operator delete[](void* data, std::align_val_t, const std::nothrow_t&) noexcept {
+  memstats::detail::deallocate(data);
+}
+#endif  // ALLOCATION_STATS
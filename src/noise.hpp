@@ -0,0 +1,97 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+#include "actor_index.hpp"
+#include "maptools.hpp"
+#include "memory_stats.hpp"
+#include "perf_stats.hpp"
+#include "pathfinding/map.hpp"
+#include "pathfinding/pathfinding.hpp"
+#include "types/ndarray.hpp"
+#include "types/noise.hpp"
+#include "types/world.hpp"
+
+namespace noise {
+constexpr int PLAYER_VOLUME = 32;  // Enough to reach anything which could see the player within FOV_RADIUS.
+constexpr int COMBAT_VOLUME = 24;
+constexpr int MAX_VOLUME = 32;
+
+/// The distance noises have travelled this turn, covering only a window of the active map around those noises.
+struct Field {
+  Position origin;  // The map position of index {0, 0}.
+  util::pmr::Array2D<int> dist;  // MAX_VOLUME minus the loudest volume heard at each tile.
+
+  /// Return true if anything can be heard at `map_pos`.
+  [[nodiscard]] auto hears(Position map_pos) const noexcept -> bool {
+    const auto local = map_pos - origin;
+    return dist.in_bounds(local) && dist[local] <= MAX_VOLUME;
+  }
+};
+
+/// Record a noise at `pos` to be heard on the next enemy turn.
+inline auto make_noise(World& world, Position pos, int volume) -> void { world.noises.push_back(Noise{pos, volume}); }
+
+/// Propagate this turns noises and the player's own presence through the active map with a bounded Dijkstra.
+/// Sound does not pass through walls.  The work done depends only on the volume of the noises, not the map size.
+/// The field and its scratch space are allocated from `arena`, normally the per-turn arena.
+[[nodiscard]] inline auto compute_field(
+    const World& world, std::pmr::memory_resource& arena = *std::pmr::get_default_resource()) -> Field {
+  const memstats::Scope memory_scope{memstats::Subsystem::pathfinding};
+  const perfstats::Timer timer{perfstats::Metric::pathfinding};
+  const auto& map = world.active_map();
+  auto sources = std::pmr::vector<Noise>{world.noises.begin(), world.noises.end(), &arena};
+  sources.push_back(Noise{world.active_player().pos, PLAYER_VOLUME});
+
+  // Cardinal steps cost 2, so a noise can never travel further than half its volume in tiles.
+  auto lo = Position{map.get_width(), map.get_height()};
+  auto hi = Position{-1, -1};
+  for (const auto& source : sources) {
+    const int reach = std::clamp(source.volume, 0, MAX_VOLUME) / 2;
+    lo = {std::min(lo.x, source.pos.x - reach), std::min(lo.y, source.pos.y - reach)};
+    hi = {std::max(hi.x, source.pos.x + reach), std::max(hi.y, source.pos.y + reach)};
+  }
+  lo = {std::max(lo.x, 0), std::max(lo.y, 0)};
+  hi = {std::min(hi.x, map.get_width() - 1), std::min(hi.y, map.get_height() - 1)};
+
+  auto field = Field{
+      lo, util::pmr::Array2D<int>{{hi.x - lo.x + 1, hi.y - lo.y + 1}, std::numeric_limits<int>::max(), &arena}};
+  auto cost = util::pmr::Array2D<int>{field.dist.get_shape(), &arena};
+  with_indexes(cost, [&cost, &map, lo](int x, int y) {
+    cost.at({x, y}) = map.tiles.at(lo + Position{x, y}) == Tiles::floor ? 1 : 0;
+  });
+
+  auto& dist = field.dist;
+  auto pathfinder = pf::Pathfinder<pf::Index2, int, std::pmr::polymorphic_allocator<pf::Index2>>{&arena};
+  const auto heuristic = [&dist](pf::Index2 xy) { return dist.at(xy); };
+  for (const auto& source : sources) {
+    const auto local = source.pos - lo;
+    if (!dist.in_bounds(local) || source.volume <= 0) continue;
+    dist.at(local) = std::min(dist.at(local), MAX_VOLUME - std::min(source.volume, MAX_VOLUME));
+    pathfinder.add(local, heuristic);
+  }
+  const auto set_edge = [&dist](pf::Index2 dest, pf::Index2 origin, int edge_distance) {
+    const auto next_dist = dist.at(origin) + edge_distance;
+    if (next_dist > MAX_VOLUME) return false;  // Too quiet to be heard.
+    if (dist.at(dest) <= next_dist) return false;
+    dist.at(dest) = next_dist;
+    return true;
+  };
+  const auto is_goal = [](auto) { return false; };
+  pathfinder.compute(pf::setup_graph(cost), heuristic, set_edge, is_goal);
+  return field;
+}
+
+/// Move any dormant actors which can hear something in `field` back onto the schedule.
+inline auto wake_actors(World& world, const Field& field) -> void {
+  if (world.dormant_actors.empty()) return;
+  with_indexes(field.dist, [&world, &field](int x, int y) {
+    if (field.dist.at({x, y}) > MAX_VOLUME) return;
+    for (auto [it, last] = world.actor_positions.equal_range(field.origin + Position{x, y}); it != last; ++it) {
+      if (world.dormant_actors.erase(it->second)) world.schedule.push_back(it->second);
+    }
+  });
+}
+}  // namespace noise
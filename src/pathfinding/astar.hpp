@@ -1,36 +1,64 @@
 #pragma once
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
 
+#include "../memory_stats.hpp"
+#include "../perf_stats.hpp"
+#include "../trace.hpp"
 #include "../types/ndarray.hpp"
 #include "map.hpp"
 #include "pathfinding.hpp"
 
 namespace pf {
+/// Return the A* priority of a position: its distance plus the octile distance to `goal`.
+/// Tile costs are at least 1, so the octile distance with the cheapest steps never overestimates and paths are optimal.
+template <typename Allocator>
 [[nodiscard]] inline auto setup_heuristic(
-    const util::Array2D<int>& dist, const Index2 goal, int cardinal = 2, int diagonal = 3) {
-  return [&dist, goal, cardinal, diagonal](Index2 pos) {
+    const util::Array2D<int, Allocator>& dist, const Index2 goal, int cardinal = 2, int diagonal = 3) {
+  // Covering both axes costs at least one diagonal or two cardinal moves, covering one axis at least either move.
+  const int diagonal_step = std::min(diagonal, cardinal * 2);
+  const int straight_step = std::min(cardinal, diagonal);
+  return [&dist, goal, diagonal_step, straight_step](Index2 pos) {
     const int diff_x = std::abs(pos.x - goal.x);
     const int diff_y = std::abs(pos.y - goal.y);
-    const int cardinal_len = std::min(diff_x, diff_y);
-    const int diagonal_len = std::max(diff_x, diff_y) - cardinal_len;
-    return dist.at(pos) + cardinal_len * cardinal + diagonal_len * diagonal;
+    const int diagonal_len = std::min(diff_x, diff_y);
+    const int straight_len = std::max(diff_x, diff_y) - diagonal_len;
+    return dist.at(pos) + diagonal_len * diagonal_step + straight_len * straight_step;
   };
 }
 
 /// Return the path from root to goal using A*.
 /// The path returned begins at goal and ends at the root.
+/// Everything A* allocates, including the returned path, comes from `allocator`.
+/// If `expanded` is not null it is set to the number of nodes expanded.
+template <typename CostAllocator, typename Allocator = std::allocator<Index2>>
 [[nodiscard]] inline auto get_astar2d_path(
-    const util::Array2D<int>& cost, Index2 root, Index2 goal, int cardinal = 2, int diagonal = 3)
-    -> std::vector<Index2> {
-  auto flow = new_flow_array(cost.get_shape());
-  auto dist = util::Array2D<int>{cost.get_shape(), std::numeric_limits<int>::max()};
+    const util::Array2D<int, CostAllocator>& cost,
+    Index2 root,
+    Index2 goal,
+    int cardinal = 2,
+    int diagonal = 3,
+    const Allocator& allocator = Allocator{},
+    size_t* expanded = nullptr) -> std::vector<Index2, Allocator> {
+  const trace::Zone trace_zone{"pf::get_astar2d_path"};
+  const memstats::Scope memory_scope{memstats::Subsystem::pathfinding};
+  const perfstats::Timer timer{perfstats::Metric::pathfinding};
+  using DistAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<int>;
+  auto flow = new_flow_array(cost.get_shape(), allocator);
+  auto dist = util::Array2D<int, DistAllocator>{cost.get_shape(), std::numeric_limits<int>::max(), allocator};
   dist.at(root) = 0;
-  auto pathfinder = pf::Pathfinder<Index2>{};
+  auto pathfinder = pf::Pathfinder<Index2, int, Allocator>{allocator};
   const auto heuristic = setup_heuristic(dist, goal, cardinal, diagonal);
   pathfinder.add(root, heuristic);
   const auto is_goal = [&goal](Index2 pos) { return pos == goal; };
-  pathfinder.compute(setup_graph(cost, cardinal, diagonal), heuristic, setup_set_edge(dist, flow), is_goal);
-  return get_path(flow, goal);
+  const auto expanded_count = with_graph(cost, cardinal, diagonal, root, [&](const auto& graph) {
+    return pathfinder.compute(graph, heuristic, setup_set_edge(dist, flow), is_goal);
+  });
+  if (expanded) *expanded = expanded_count;
+  return get_path(flow, goal, allocator);
 }
 }  // namespace pf
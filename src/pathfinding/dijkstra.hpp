@@ -1,6 +1,9 @@
 #pragma once
 #include <cassert>
+#include <cstddef>
 
+#include "../memory_stats.hpp"
+#include "../perf_stats.hpp"
 #include "../types/ndarray.hpp"
 #include "map.hpp"
 #include "pathfinding.hpp"
@@ -13,6 +16,8 @@ namespace pf {
 inline auto dijkstra2d(util::Array2D<int>& dist, const util::Array2D<int>& cost, int cardinal = 2, int diagonal = 3)
     -> void {
   assert(dist.get_shape() == cost.get_shape());
+  const memstats::Scope memory_scope{memstats::Subsystem::pathfinding};
+  const perfstats::Timer timer{perfstats::Metric::pathfinding};
   auto pathfinder = pf::Pathfinder<Index2>{};
   const auto heuristic = setup_heuristic(dist);
   with_indexes(dist, [&dist, &pathfinder, &heuristic](int x, int y) {
@@ -23,15 +28,26 @@ inline auto dijkstra2d(util::Array2D<int>& dist, const util::Array2D<int>& cost,
   pathfinder.compute(setup_graph(cost, cardinal, diagonal), heuristic, setup_set_edge(dist), is_goal);
 }
 
+/// Return the distance from `start_xy` to every index of `cost`, or int max where it can not be reached.
+/// If `expanded` is not null it is set to the number of nodes expanded.
 [[nodiscard]] inline auto dijkstra2d(
-    const Index2& start_xy, const util::Array2D<int>& cost, int cardinal = 2, int diagonal = 3) -> util::Array2D<int> {
+    const Index2& start_xy,
+    const util::Array2D<int>& cost,
+    int cardinal = 2,
+    int diagonal = 3,
+    size_t* expanded = nullptr) -> util::Array2D<int> {
+  const memstats::Scope memory_scope{memstats::Subsystem::pathfinding};
+  const perfstats::Timer timer{perfstats::Metric::pathfinding};
   auto dist = util::Array2D<int>{cost.get_shape(), std::numeric_limits<int>::max()};
   dist.at(start_xy) = 0;
   auto pathfinder = pf::Pathfinder<Index2>{};
   const auto heuristic = setup_heuristic(dist);
   pathfinder.add(start_xy, heuristic);
   const auto is_goal = [](auto) { return false; };
-  pathfinder.compute(setup_graph(cost, cardinal, diagonal), heuristic, setup_set_edge(dist), is_goal);
+  const auto expanded_count = with_graph(cost, cardinal, diagonal, start_xy, [&](const auto& graph) {
+    return pathfinder.compute(graph, heuristic, setup_set_edge(dist), is_goal);
+  });
+  if (expanded) *expanded = expanded_count;
   return dist;
 }
 }  // namespace pf
@@ -1,5 +1,7 @@
 #pragma once
 #include <cassert>
+#include <memory>
+#include <vector>
 
 #include "../maptools.hpp"
 #include "../types/ndarray.hpp"
@@ -8,11 +10,13 @@
 namespace pf {
 using Index2 = Position;  // 2D coordinates.
 
-[[nodiscard]] inline auto setup_graph(const util::Array2D<int>& cost, int cardinal = 2, int diagonal = 3) {
+template <typename Allocator, typename Layout>
+[[nodiscard]] inline auto setup_graph(
+    const util::Array2D<int, Allocator, Layout>& cost, int cardinal = 2, int diagonal = 3) {
   return [cardinal, diagonal, &cost](const Index2& xy, auto add_edge) {
     const auto check_add_edge = [&](int x, int y, int edge_cost) {
       if (!cost.in_bounds({x, y})) return;
-      edge_cost *= cost.at({x, y});
+      edge_cost *= cost[{x, y}];
       if (edge_cost <= 0) return;
       add_edge({x, y}, edge_cost);
     };
@@ -27,7 +31,77 @@ using Index2 = Position;  // 2D coordinates.
   };
 }
 
-[[nodiscard]] inline auto setup_set_edge(util::Array2D<int>& dist) {
+/// Return true if `xy` is inside of the outermost indexes of `cost`.
+template <typename Allocator, typename Layout>
+[[nodiscard]] inline auto is_interior(const util::Array2D<int, Allocator, Layout>& cost, Index2 xy) noexcept -> bool {
+  return 0 < xy.x && xy.x < cost.get_width() - 1 && 0 < xy.y && xy.y < cost.get_height() - 1;
+}
+
+/// Return true if every index on the edge of `cost` is blocked.
+/// Then a search starting from an interior index never reaches the edge, so its neighbors need no bounds checks.
+template <typename Allocator, typename Layout>
+[[nodiscard]] inline auto is_bordered(const util::Array2D<int, Allocator, Layout>& cost) noexcept -> bool {
+  const int width = cost.get_width();
+  const int height = cost.get_height();
+  for (int x{0}; x < width; ++x) {
+    if (cost[{x, 0}] > 0 || cost[{x, height - 1}] > 0) return false;
+  }
+  for (int y{0}; y < height; ++y) {
+    if (cost[{0, y}] > 0 || cost[{width - 1, y}] > 0) return false;
+  }
+  return true;
+}
+
+/// Like `setup_graph` but with the connectivity and costs fixed at compile time, so the neighbor loops unroll.
+/// `Connectivity` is 4 for cardinal moves only or 8 to include diagonals.
+/// If `Bordered` then every index expanded must be interior, see `is_bordered`, and neighbors are not bounds checked.
+/// Neighbors are visited in the same order as `setup_graph`, so searches give identical results.
+template <
+    int Connectivity = 8,
+    int Cardinal = 2,
+    int Diagonal = 3,
+    bool Bordered = false,
+    typename Allocator,
+    typename Layout>
+[[nodiscard]] inline auto setup_grid_graph(const util::Array2D<int, Allocator, Layout>& cost) {
+  static_assert(Connectivity == 4 || Connectivity == 8, "Grid graphs have 4 or 8 neighbors.");
+  static_assert(Cardinal > 0 && Diagonal > 0, "Edge costs must be positive.");
+  return [&cost](const Index2& xy, auto add_edge) {
+    if constexpr (Bordered) assert(is_interior(cost, xy));
+    const auto check_add_edge = [&](Index2 next, int edge_cost) {
+      if constexpr (!Bordered) {
+        if (!cost.in_bounds(next)) return;
+      }
+      const int tile_cost = cost[next];
+      if (tile_cost <= 0) return;
+      add_edge(next, edge_cost * tile_cost);
+    };
+    check_add_edge({xy.x, xy.y - 1}, Cardinal);
+    check_add_edge({xy.x - 1, xy.y}, Cardinal);
+    check_add_edge({xy.x + 1, xy.y}, Cardinal);
+    check_add_edge({xy.x, xy.y + 1}, Cardinal);
+    if constexpr (Connectivity == 8) {
+      check_add_edge({xy.x - 1, xy.y - 1}, Diagonal);
+      check_add_edge({xy.x + 1, xy.y - 1}, Diagonal);
+      check_add_edge({xy.x - 1, xy.y + 1}, Diagonal);
+      check_add_edge({xy.x + 1, xy.y + 1}, Diagonal);
+    }
+  };
+}
+
+/// Return `func(graph)` with the graph of `cost` for a search from `root`.
+/// The default costs on a bordered `cost` use a specialized graph, other costs fall back to `setup_graph`.
+template <typename Allocator, typename Layout, typename Func>
+inline decltype(auto) with_graph(
+    const util::Array2D<int, Allocator, Layout>& cost, int cardinal, int diagonal, Index2 root, Func&& func) {
+  if (cardinal == 2 && diagonal == 3 && is_interior(cost, root) && is_bordered(cost)) {
+    return func(setup_grid_graph<8, 2, 3, true>(cost));
+  }
+  return func(setup_graph(cost, cardinal, diagonal));
+}
+
+template <typename Allocator, typename Layout>
+[[nodiscard]] inline auto setup_set_edge(util::Array2D<int, Allocator, Layout>& dist) {
   return [&dist](Index2 dest, Index2 origin, int edge_distance) {
     const auto next_dist = dist.at(origin) + edge_distance;
     if (dist.at(dest) <= next_dist) return false;
@@ -36,7 +110,9 @@ using Index2 = Position;  // 2D coordinates.
   };
 }
 
-[[nodiscard]] inline auto setup_set_edge(util::Array2D<int>& dist, util::Array2D<Index2>& flow) {
+template <typename DistAllocator, typename FlowAllocator>
+[[nodiscard]] inline auto setup_set_edge(
+    util::Array2D<int, DistAllocator>& dist, util::Array2D<Index2, FlowAllocator>& flow) {
   return [&dist, &flow](Index2 dest, Index2 origin, int edge_distance) {
     const auto next_dist = dist.at(origin) + edge_distance;
     if (dist.at(dest) <= next_dist) return false;
@@ -46,15 +122,20 @@ using Index2 = Position;  // 2D coordinates.
   };
 }
 
-[[nodiscard]] inline auto new_flow_array(std::array<int, 2> shape) -> util::Array2D<Index2> {
-  auto flow = util::Array2D<Index2>(shape);
+template <typename Allocator = std::allocator<Index2>>
+[[nodiscard]] inline auto new_flow_array(std::array<int, 2> shape, const Allocator& allocator = Allocator{})
+    -> util::Array2D<Index2, Allocator> {
+  auto flow = util::Array2D<Index2, Allocator>(shape, allocator);
   with_indexes(flow, [&flow](int x, int y) { flow.at({x, y}) = {x, y}; });
   return flow;
 }
 
 /// Return a path along a flow-map from start to a neutral index.
-[[nodiscard]] inline auto get_path(const util::Array2D<Index2>& flow, Index2 start) -> std::vector<Index2> {
-  auto path = std::vector<Index2>{};
+template <typename FlowAllocator, typename Allocator = std::allocator<Index2>>
+[[nodiscard]] inline auto get_path(
+    const util::Array2D<Index2, FlowAllocator>& flow, Index2 start, const Allocator& allocator = Allocator{})
+    -> std::vector<Index2, Allocator> {
+  auto path = std::vector<Index2, Allocator>{allocator};
   path.emplace_back(start);
   while (path.back() != flow.at(path.back())) {
     assert(std::ranges::find(path, flow.at(path.back())) == path.end());  // Recursion check.
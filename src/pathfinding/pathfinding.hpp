@@ -1,13 +1,17 @@
 #pragma once
 #include <algorithm>
+#include <cstddef>
+#include <memory>
 #include <tuple>
 #include <vector>
 namespace pf {
 /// A generic pathfinder template.
-template <typename IndexType, typename DistType = int>
+template <typename IndexType, typename DistType = int, typename Allocator = std::allocator<IndexType>>
 class Pathfinder {
  public:
   Pathfinder() = default;
+  /// Allocate the frontier with `allocator`.
+  explicit Pathfinder(const Allocator& allocator) : frontier_{NodeAllocator{allocator}} {}
 
   /// Add an index to this frontier.
   template <typename Heuristic>
@@ -26,16 +30,17 @@ class Pathfinder {
     std::make_heap(frontier_.begin(), frontier_.end(), get_frontier_predicate_());
   }
 
-  /// Run a pathfinder until a goal is reached.
+  /// Run a pathfinder until a goal is reached.  Returns the number of nodes expanded.
   template <typename GraphFunc, typename Heuristic, typename SetEdgeFunc, typename GoalFunc>
-  void compute(
+  auto compute(
       const GraphFunc& graph,  // [](const IndexType& index, add_edge) -> void { add_edge(dest, distance); }
       const Heuristic& heuristic,  // [](const IndexType& index) -> DistType {}
       const SetEdgeFunc& set_edge,  // [](dest, origin, distance) -> bool {}
-      const GoalFunc& is_goal = [](const IndexType&) -> bool { return false; }) {
+      const GoalFunc& is_goal = [](const IndexType&) -> bool { return false; }) -> size_t {
+    size_t expanded = 0;
     while (frontier_.size()) {
       const IndexType current_index = frontier_.at(0).index;
-      if (is_goal(current_index)) return;
+      if (is_goal(current_index)) return expanded;
       const auto add_edge = [&](const IndexType& next_index, const DistType& distance) {
         if (!set_edge(next_index, current_index, distance)) {
           return;  // set_edge should return false if the edge would go backwards.
@@ -46,7 +51,9 @@ class Pathfinder {
       std::pop_heap(frontier_.begin(), frontier_.end(), get_frontier_predicate_());
       frontier_.pop_back();
       graph(current_index, add_edge);
+      ++expanded;
     }
+    return expanded;
   }
 
  private:
@@ -57,6 +64,7 @@ class Pathfinder {
   constexpr auto get_frontier_predicate_() {
     return [](const NodeType& lhs, const NodeType& rhs) -> bool { return lhs.distance > rhs.distance; };
   }
-  std::vector<NodeType> frontier_;  // The frontier heap queue.
+  using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<NodeType>;
+  std::vector<NodeType, NodeAllocator> frontier_;  // The frontier heap queue.
 };
 }  // namespace pf
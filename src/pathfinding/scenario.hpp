@@ -0,0 +1,130 @@
+#pragma once
+#include <fmt/format.h>
+
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../types/ndarray.hpp"
+#include "map.hpp"
+
+/*****************************************************************************
+    Grid pathfinding benchmarks in the .map and .scen formats of the Moving AI Lab benchmark sets.
+
+    A .map file is a header followed by one character per tile:
+
+        type octile
+        height 2
+        width 3
+        map
+        ..@
+        .T.
+
+    Ground ('.' and 'G') and swamp ('S') can be walked on and load as cost 1, anything else loads as cost 0, blocked.
+
+    A .scen file is a version line followed by one query per line with tab separated columns: bucket, map file, map
+    width, map height, start x, start y, goal x, goal y and optimal length.  The optimal lengths of published sets
+    assume diagonal steps cost sqrt(2) and can not cut corners, which differs from the costs used here, so they are
+    kept for reference but not checked against.
+ */
+namespace pf {
+/// One query of a .scen file.
+struct Scenario {
+  int bucket = 0;
+  std::string map;  // The .map file, relative to the .scen file.
+  int width = 0;
+  int height = 0;
+  Index2 start;
+  Index2 goal;
+  double optimal_length = 0;
+};
+
+/// Return the cost of each tile of the .map file in `in`, 1 where it can be walked on and 0 where it is blocked.
+/// Throws std::runtime_error if the file is malformed.
+[[nodiscard]] inline auto read_grid_map(std::istream& in) -> util::Array2D<int> {
+  int width = -1;
+  int height = -1;
+  auto word = std::string{};
+  while (in >> word && word != "map") {
+    if (word == "type") {
+      in >> word;
+    } else if (word == "width") {
+      in >> width;
+    } else if (word == "height") {
+      in >> height;
+    } else {
+      throw std::runtime_error("Unknown map header: " + word);
+    }
+  }
+  if (word != "map" || width <= 0 || height <= 0) throw std::runtime_error("Map header is incomplete.");
+  auto cost = util::Array2D<int>{{width, height}};
+  auto line = std::string{};
+  std::getline(in, line);  // The rest of the "map" line.
+  for (int y{0}; y < height; ++y) {
+    if (!std::getline(in, line)) throw std::runtime_error(fmt::format("Map ends at row {} of {}.", y, height));
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (std::ssize(line) < width) throw std::runtime_error(fmt::format("Map row {} is too short.", y));
+    for (int x{0}; x < width; ++x) {
+      const char tile = line.at(x);
+      cost.at({x, y}) = tile == '.' || tile == 'G' || tile == 'S' ? 1 : 0;
+    }
+  }
+  return cost;
+}
+[[nodiscard]] inline auto read_grid_map(const std::filesystem::path& path) -> util::Array2D<int> {
+  auto in = std::ifstream{path};
+  if (!in) throw std::runtime_error("Could not open " + path.string());
+  return read_grid_map(in);
+}
+
+/// Write `cost` as a .map file, '.' where the cost is positive and '@' elsewhere.
+inline void write_grid_map(std::ostream& out, const util::Array2D<int>& cost) {
+  out << "type octile\nheight " << cost.get_height() << "\nwidth " << cost.get_width() << "\nmap\n";
+  for (int y{0}; y < cost.get_height(); ++y) {
+    for (int x{0}; x < cost.get_width(); ++x) out << (cost.at({x, y}) > 0 ? '.' : '@');
+    out << '\n';
+  }
+}
+
+/// Return the queries of the .scen file in `in`.  Throws std::runtime_error if the file is malformed.
+[[nodiscard]] inline auto read_scenarios(std::istream& in) -> std::vector<Scenario> {
+  auto word = std::string{};
+  double version = 0;
+  if (!(in >> word >> version) || word != "version") throw std::runtime_error("Scenario file has no version.");
+  auto scenarios = std::vector<Scenario>{};
+  auto it = Scenario{};
+  while (in >> it.bucket >> it.map >> it.width >> it.height >> it.start.x >> it.start.y >> it.goal.x >> it.goal.y >>
+         it.optimal_length) {
+    scenarios.emplace_back(it);
+  }
+  if (!in.eof()) throw std::runtime_error(fmt::format("Scenario {} is malformed.", scenarios.size() + 1));
+  return scenarios;
+}
+[[nodiscard]] inline auto read_scenarios(const std::filesystem::path& path) -> std::vector<Scenario> {
+  auto in = std::ifstream{path};
+  if (!in) throw std::runtime_error("Could not open " + path.string());
+  return read_scenarios(in);
+}
+
+/// Write `scenarios` as a .scen file.
+inline void write_scenarios(std::ostream& out, const std::vector<Scenario>& scenarios) {
+  out << "version 1\n";
+  for (const auto& it : scenarios) {
+    out << fmt::format(
+        "{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{:.8f}\n",
+        it.bucket,
+        it.map,
+        it.width,
+        it.height,
+        it.start.x,
+        it.start.y,
+        it.goal.x,
+        it.goal.y,
+        it.optimal_length);
+  }
+}
+}  // namespace pf
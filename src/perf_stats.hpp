@@ -0,0 +1,153 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <utility>
+
+/*****************************************************************************
+    Rolling timings of frames, turns and saves for the performance overlay.
+
+    Timings are collected into a Collector owned by each GameContext, so worlds run side by side never share one.
+    A Scope makes a collector current on the calling thread, and a Timer adds the time from its construction to its
+    destruction to a metric of the current collector.  Timers on a thread without a current collector do nothing.
+
+    Like memory_stats.hpp, metrics are collected in windows: `end_window(Window::turn)` is called when each turn ends,
+    `end_window(Window::frame)` after each frame is drawn and `end_window(Window::save)` once each save is written.
+    Ending a window takes what its metrics added up to as one sample, and the last SAMPLE_COUNT samples of each metric
+    are kept for `Collector::get_summary`.
+
+    Tasks on other threads only count if they open a Scope, and parallel work adds up the time of every thread.
+    Time added between windows, such as pathfinding for the player's own action, goes into the next sample.  Timers
+    of one metric must not nest or the inner time counts twice.
+
+    Timing is always on: a Timer reads the clock twice and adds to one atomic, which is cheap next to what it times.
+ */
+namespace perfstats {
+/// What is timed.  Turn metrics other than `turn` are parts of it.
+enum class Metric : uint8_t { frame, turn, fov, ai, pathfinding, message_log, save };
+inline constexpr size_t METRIC_COUNT = 7;
+inline constexpr auto METRIC_NAMES = std::array<std::string_view, METRIC_COUNT>{
+    "frame", "turn", "FOV", "AI", "pathfinding", "message log", "save"};
+
+/// When samples of a metric are taken.
+enum class Window : uint8_t { frame, turn, save };
+inline constexpr auto METRIC_WINDOWS = std::array<Window, METRIC_COUNT>{
+    Window::frame, Window::turn, Window::turn, Window::turn, Window::turn, Window::turn, Window::save};
+
+inline constexpr size_t SAMPLE_COUNT = 64;  // Samples kept for each metric.
+
+/// The recent samples of one metric, in milliseconds.
+struct Summary {
+  double last = 0;
+  double average = 0;  // Over the kept samples.
+  double max = 0;  // Of the kept samples.
+  size_t samples = 0;  // How many samples are kept, 0 if none were taken yet.
+};
+
+/// The timings of one world.  Timers may add to it from any thread.
+class Collector {
+ public:
+  Collector() = default;
+  Collector(const Collector&) = delete;
+  Collector& operator=(const Collector&) = delete;
+
+  /// Add `nanoseconds` to the pending sample of `metric`.
+  void add(Metric metric, int64_t nanoseconds) noexcept {
+    pending_[static_cast<size_t>(metric)].nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+  }
+
+  /// Take a sample of every metric of `window` from the time added since it last ended.
+  void end_window(Window window) {
+    auto lock = std::lock_guard{mutex_};
+    for (size_t i{0}; i < METRIC_COUNT; ++i) {
+      if (METRIC_WINDOWS[i] != window) continue;
+      auto& history = histories_[i];
+      history.samples[history.count++ % SAMPLE_COUNT] = pending_[i].nanoseconds.exchange(0);
+    }
+  }
+
+  /// Return the recent samples of `metric`.
+  [[nodiscard]] auto get_summary(Metric metric) const -> Summary {
+    auto lock = std::lock_guard{mutex_};
+    const auto& history = histories_[static_cast<size_t>(metric)];
+    if (!history.count) return {};
+    const auto samples = static_cast<size_t>(std::min<uint64_t>(history.count, SAMPLE_COUNT));
+    const auto kept = std::span{history.samples}.first(samples);
+    int64_t total = 0;
+    for (const auto sample : kept) total += sample;
+    constexpr double MILLISECONDS = 1e-6;
+    return {
+        static_cast<double>(history.samples[(history.count - 1) % SAMPLE_COUNT]) * MILLISECONDS,
+        static_cast<double>(total) / static_cast<double>(samples) * MILLISECONDS,
+        static_cast<double>(*std::ranges::max_element(kept)) * MILLISECONDS,
+        samples};
+  }
+
+ private:
+  /// Time added by timers since the window of this metric last ended.
+  struct alignas(64) Pending {
+    std::atomic<int64_t> nanoseconds = 0;
+  };
+  /// The most recent samples of one metric.
+  struct History {
+    std::array<int64_t, SAMPLE_COUNT> samples = {};  // Nanoseconds, samples[(count - 1) % SAMPLE_COUNT] is the last.
+    uint64_t count = 0;  // Samples ever taken.
+  };
+
+  std::array<Pending, METRIC_COUNT> pending_ = {};
+  mutable std::mutex mutex_;  // Guards `histories_`.
+  std::array<History, METRIC_COUNT> histories_ = {};
+};
+
+namespace detail {
+using Clock = std::chrono::steady_clock;
+inline thread_local Collector* current = nullptr;  // Set by Scope.
+}  // namespace detail
+
+/// Return the collector timers of the calling thread add to, or nullptr if there is none.
+[[nodiscard]] inline auto get_current() noexcept -> Collector* { return detail::current; }
+
+/// Make `collector` current on the calling thread until destroyed.  Scopes nest, a null collector stops collecting.
+class Scope {
+ public:
+  explicit Scope(Collector* collector) noexcept : previous_{std::exchange(detail::current, collector)} {}
+  explicit Scope(Collector& collector) noexcept : Scope{&collector} {}
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+  ~Scope() { detail::current = previous_; }
+
+ private:
+  Collector* previous_ = nullptr;
+};
+
+/// Add the time until destroyed to `metric` of the current collector.
+class Timer {
+ public:
+  explicit Timer(Metric metric) noexcept : collector_{detail::current}, metric_{metric} {
+    if (collector_) start_ = detail::Clock::now();
+  }
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
+  ~Timer() {
+    if (!collector_) return;
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(detail::Clock::now() - start_);
+    collector_->add(metric_, elapsed.count());
+  }
+
+ private:
+  Collector* collector_ = nullptr;
+  Metric metric_ = Metric::frame;
+  detail::Clock::time_point start_;
+};
+
+/// Take a sample of every metric of `window` in the current collector, if any.
+inline void end_window(Window window) {
+  if (auto* collector = detail::current) collector->end_window(window);
+}
+}  // namespace perfstats
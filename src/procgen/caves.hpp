@@ -2,20 +2,29 @@
 
 #include <fmt/core.h>
 
+#include <cassert>
 #include <gsl/gsl>
 #include <random>
+#include <span>
+#include <utility>
 
 #include "../actions/ai_basic.hpp"
+#include "../actor_index.hpp"
+#include "../constants.hpp"
 #include "../fov.hpp"
+#include "../memory_stats.hpp"
 #include "../items/health_potion.hpp"
+#include "../jobs.hpp"
 #include "../items/scroll_confusion.hpp"
 #include "../items/scroll_fireball.hpp"
 #include "../items/scroll_lightning.hpp"
 #include "../maptools.hpp"
+#include "../trace.hpp"
 #include "../types/map.hpp"
 #include "../types/ndarray.hpp"
 #include "../types/world.hpp"
 #include "../world_logic.hpp"
+#include "level_params.hpp"
 
 namespace procgen {
 /// Call func on the neighbors surrounding x, y.  This may go out of bounds.
@@ -30,27 +39,37 @@ inline void with_neighbors(
     func(x + adj.at(0), y + adj.at(1));
   }
 }
+/// Call func(x, y, neighbor_walls) on each tile of row `y` of the given tiles array.
+/// Neighbors out of bounds count as walls.
+template <typename Func>
+inline void with_row_neighbors(const util::Array2D<Tiles>& tiles, int y, Func func) {
+  const int width = tiles.get_width();
+  const auto above = y > 0 ? tiles.row(y - 1) : std::span<const Tiles>{};
+  const auto here = tiles.row(y);
+  const auto below = y + 1 < tiles.get_height() ? tiles.row(y + 1) : std::span<const Tiles>{};
+  const auto wall_at = [width](std::span<const Tiles> row, int x) -> int {
+    return row.empty() || x < 0 || x >= width || row[x] == Tiles::wall;
+  };
+  for (int x{0}; x < width; ++x) {
+    const int walls = wall_at(above, x - 1) + wall_at(above, x) + wall_at(above, x + 1) + wall_at(here, x - 1) +
+                      wall_at(here, x + 1) + wall_at(below, x - 1) + wall_at(below, x) + wall_at(below, x + 1);
+    func(x, y, walls);
+  }
+}
 /// Call func(x, y, neighbor_walls) on each tile of the given tiles array.
 template <typename Func>
 inline void with_tiles_neighbors(const util::Array2D<Tiles>& tiles, Func func) {
-  with_indexes(tiles, [&tiles, func](int x, int y) {
-    int walls = 0;
-    with_neighbors(x, y, [&tiles, &walls](int nx, int ny) {
-      if (!tiles.in_bounds({nx, ny})) {
-        walls += 1;
-        return;
-      }
-      if (tiles.at({nx, ny}) == Tiles::wall) walls += 1;
-    });
-    func(x, y, walls);
-  });
+  for (int y{0}; y < tiles.get_height(); ++y) with_row_neighbors(tiles, y, func);
 }
 
-inline void cave_gen_step(Map& map) {
-  auto tiles_clone = map.tiles;
-  with_tiles_neighbors(tiles_clone, [&map](int x, int y, int walls) {
-    if (walls < 4) map.tiles.at({x, y}) = Tiles::floor;
-    if (walls >= 5) map.tiles.at({x, y}) = Tiles::wall;
+inline void cave_gen_step(Map& map, jobs::Scheduler* scheduler = nullptr) {
+  const auto tiles_clone = map.tiles;
+  jobs::parallel_for_rows(scheduler, tiles_clone, [&map, &tiles_clone](int y) {
+    const auto row = map.tiles.row(y);
+    with_row_neighbors(tiles_clone, y, [row](int x, int, int walls) {
+      if (walls < 4) row[x] = Tiles::floor;
+      if (walls >= 5) row[x] = Tiles::wall;
+    });
   });
 }
 
@@ -69,12 +88,21 @@ inline void shuffle_tiles(World& world, Map& map, const std::vector<Position>& s
   }
 }
 
-inline void cave_gen_ca_shuffle_step(World& world, Map& map) {
-  auto shuffle_space = std::vector<Position>{};
-  with_tiles_neighbors(map.tiles, [&shuffle_space, &map](int x, int y, int walls) {
-    if (map.tiles.at({x, y}) == Tiles::wall && walls < 4) shuffle_space.emplace_back(Position{x, y});
-    if (map.tiles.at({x, y}) == Tiles::floor && walls >= 5) shuffle_space.emplace_back(Position{x, y});
+inline void cave_gen_ca_shuffle_step(World& world, Map& map, jobs::Scheduler* scheduler = nullptr) {
+  const trace::Zone trace_zone{"procgen::cave_gen_ca_shuffle_step"};
+  // Rows are checked in parallel and joined in order, so the result does not depend on the number of threads.
+  auto row_spaces = std::vector<std::vector<Position>>(map.get_height());
+  jobs::parallel_for_rows(scheduler, map.tiles, [&row_spaces, &map](int y) {
+    const auto row = std::as_const(map.tiles).row(y);
+    with_row_neighbors(map.tiles, y, [&row_space = row_spaces.at(y), row](int x, int y, int walls) {
+      if (row[x] == Tiles::wall && walls < 4) row_space.emplace_back(Position{x, y});
+      if (row[x] == Tiles::floor && walls >= 5) row_space.emplace_back(Position{x, y});
+    });
   });
+  auto shuffle_space = std::vector<Position>{};
+  for (const auto& row_space : row_spaces) {
+    shuffle_space.insert(shuffle_space.end(), row_space.begin(), row_space.end());
+  }
   shuffle_tiles(world, map, shuffle_space);
 }
 
@@ -82,63 +110,123 @@ inline auto map_label(util::Array2D<signed char> tiles) -> std::tuple<util::Arra
   auto labels = util::Array2D<int>{tiles.get_shape(), 0};
   auto label_count = int{0};
 
-  auto fill_label = [&labels, &tiles](std::array<int, 2> xy, int label_i, auto& recursive) {
-    if (!tiles.in_bounds(xy)) return;
-    if (!tiles.at(xy)) return;
-    tiles.at(xy) = false;
-    labels.at(xy) = label_i;
-    const auto [x, y] = xy;
-    recursive({x, y - 1}, label_i, recursive);
-    recursive({x - 1, y}, label_i, recursive);
-    recursive({x + 1, y}, label_i, recursive);
-    recursive({x, y + 1}, label_i, recursive);
+  // Flood fill with an explicit stack, large caves would overflow the call stack if this was recursive.
+  auto stack = std::vector<std::array<int, 2>>{};
+  const auto fill_label = [&labels, &tiles, &stack](std::array<int, 2> start, int label_i) {
+    stack.emplace_back(start);
+    while (stack.size()) {
+      const auto xy = stack.back();
+      stack.pop_back();
+      if (!tiles.in_bounds(xy)) continue;
+      if (!tiles.at(xy)) continue;
+      tiles.at(xy) = false;
+      labels.at(xy) = label_i;
+      const auto [x, y] = xy;
+      stack.push_back({x, y + 1});
+      stack.push_back({x + 1, y});
+      stack.push_back({x - 1, y});
+      stack.push_back({x, y - 1});
+    }
   };
 
   with_indexes(tiles, [&tiles, &fill_label, &label_count](int x, int y) {
-    if (tiles.at({x, y})) fill_label({x, y}, ++label_count, fill_label);
+    if (tiles.at({x, y})) fill_label({x, y}, ++label_count);
   });
   return {std::move(labels), label_count};
 }
 
 inline auto fill_holes(Map& map) -> void {
+  const trace::Zone trace_zone{"procgen::fill_holes"};
   auto is_floor = util::Array2D<signed char>{map.tiles.get_shape()};
   std::ranges::transform(map.tiles, is_floor.begin(), [](auto t) { return t == Tiles::floor; });
 
   util::Array2D<int> labels;
   int label_n;
   std::tie(labels, label_n) = map_label(is_floor);
-  std::vector<ptrdiff_t> label_sizes;
-  label_sizes.reserve(label_n);
-  for (int i{0}; i < label_n; ++i) {
-    label_sizes.emplace_back(std::ranges::count(labels, i + 1));
+  auto label_sizes = std::vector<ptrdiff_t>(label_n, 0);
+  for (const auto label : labels) {
+    if (label) ++label_sizes.at(label - 1);
   }
 
   const auto biggest_label = gsl::narrow<int>(std::ranges::max_element(label_sizes) - label_sizes.begin()) + 1;
 
-  with_indexes(labels, [&labels, biggest_label, &map](int x, int y) {
-    if (labels.at({x, y}) && labels.at({x, y}) != biggest_label) {
-      map.tiles.at({x, y}) = Tiles::wall;
-    }
-  });
+  util::zip(
+      [biggest_label](int label, Tiles& tile) {
+        if (label && label != biggest_label) tile = Tiles::wall;
+      },
+      labels,
+      map.tiles);
 
-  fmt::print("Filled {} holes.\n", label_n - 1);
+#ifndef NDEBUG
+  fmt::print(stderr, "Filled {} holes.\n", label_n - 1);
+#endif
 }
 
-/// Pop and return a random item from a vector.
+/// Pop and return a random item from a vector.  The order of the remaining items is not preserved.
 template <typename VectorLike, typename RNG>
 inline auto pop_random(VectorLike& list, RNG& rng) {
+  assert(list.size());
   auto pop_iter = list.begin() + rng() % list.size();
   auto item = std::move(*pop_iter);
-  list.erase(pop_iter);
+  *pop_iter = std::move(list.back());
+  list.pop_back();
   return item;
 }
 
-inline auto generate_level(World& world, int level = 1) -> Map& {
-  const int WIDTH = 80;
-  const int HEIGHT = 45;
+inline auto spawn_orc(World& world, Position pos, const MonsterStats& stats = LevelParams{}.orc_stats) -> Actor& {
+  auto& [monster_id, monster] = *new_actor(world);
+  monster.pos = pos;
+  monster.name = "orc";
+  monster.ch = 'o';
+  monster.fg = {63, 127, 63};
+  monster.stats.max_hp = monster.stats.hp = stats.hp;
+  monster.stats.attack = stats.attack;
+  monster.stats.defense = stats.defense;
+  monster.stats.xp = stats.xp;
+  monster.ai = std::make_unique<action::BasicAI>();
+  world.dormant_actors.insert(monster_id);  // Sleeps until the player is heard.
+  world.active_actors.insert(monster_id);
+  index_actor(world, monster);
+  return monster;
+}
+
+inline auto spawn_troll(World& world, Position pos, const MonsterStats& stats = LevelParams{}.troll_stats) -> Actor& {
+  auto& [monster_id, monster] = *new_actor(world);
+  monster.pos = pos;
+  monster.name = "troll";
+  monster.ch = 'T';
+  monster.fg = tcod::ColorRGB{0, 127, 0};
+  monster.stats.max_hp = monster.stats.hp = stats.hp;
+  monster.stats.attack = stats.attack;
+  monster.stats.defense = stats.defense;
+  monster.stats.xp = stats.xp;
+  monster.ai = std::make_unique<action::BasicAI>();
+  world.dormant_actors.insert(monster_id);  // Sleeps until the player is heard.
+  world.active_actors.insert(monster_id);
+  index_actor(world, monster);
+  return monster;
+}
+
+/// Return the level of the caves at `level`, generating it if it does not exist yet.
+/// A newly generated level becomes the active map with the player at its up stairs.
+/// The optional scheduler only speeds up generation, the result is the same without it.
+inline auto generate_level(
+    World& world,
+    int level,
+    const LevelParams& params,
+    bool simulate_frozen = false,
+    jobs::Scheduler* scheduler = nullptr) -> Map& {
+  const trace::Zone trace_zone{"procgen::generate_level"};
+  const memstats::Scope memory_scope{memstats::Subsystem::procgen};
+  const int WIDTH = params.width;
+  const int HEIGHT = params.height;
   const auto map_id = MapID{"caves", level};
-  if (auto found_map = world.maps.find(map_id); found_map != world.maps.end()) return found_map->second;
+  if (auto* found_map = world.find_map(map_id)) return *found_map;
 
+  // The previous map must be frozen first, otherwise its actors would be left on the new map.
+  if (auto previous = world.maps.find(world.current_map_id); previous != world.maps.end()) {
+    freeze_map(world, previous->second, simulate_frozen, scheduler);
+  }
   auto& map = world.maps[map_id] = Map{WIDTH, HEIGHT};
   world.current_map_id = map.id = map_id;
 
@@ -149,7 +237,7 @@ inline auto generate_level(World& world, int level = 1) -> Map& {
   shuffle_list(map.tiles.get_container(), world.rng);
 
   for (int repeats{0}; repeats < 5; ++repeats) {
-    cave_gen_ca_shuffle_step(world, map);
+    cave_gen_ca_shuffle_step(world, map, scheduler);
   }
   with_border(WIDTH, HEIGHT, [&map](int x, int y) { map.tiles.at({x, y}) = Tiles::wall; });
   fill_holes(map);
@@ -164,13 +252,13 @@ inline auto generate_level(World& world, int level = 1) -> Map& {
   map.fixtures[up_stairs_pos] = Fixture{"up stairs", '<'};
 
   auto& player = world.active_player();
-  player.pos = up_stairs_pos;
+  move_actor(world, player, up_stairs_pos);
   update_fov(map, player.pos);
 
-  for (int repeats{0}; repeats < 5; ++repeats) {
+  for (int repeats{0}; repeats < params.health_potions; ++repeats) {
     map.items.emplace(pop_random(floor_tiles, world.rng), std::make_unique<HealthPotion>());
   }
-  for (int repeats{0}; repeats < 2; ++repeats) {
+  for (int repeats{0}; repeats < params.scrolls; ++repeats) {
     map.items.emplace(pop_random(floor_tiles, world.rng), std::make_unique<LightningScroll>());
     map.items.emplace(pop_random(floor_tiles, world.rng), std::make_unique<FireballScroll>());
     map.items.emplace(pop_random(floor_tiles, world.rng), std::make_unique<ConfusionScroll>());
@@ -179,36 +267,24 @@ inline auto generate_level(World& world, int level = 1) -> Map& {
   // Remove tiles in FOV.
   std::erase_if(floor_tiles, [&map](Position pos) { return map.visible.at(pos); });
 
-  for (int repeats{0}; repeats < 20; ++repeats) {
-    auto& [monster_id, monster] = *new_actor(world);
-    monster.pos = pop_random(floor_tiles, world.rng);
-    monster.name = "orc";
-    monster.ch = 'o';
-    monster.fg = {63, 127, 63};
-    monster.stats.max_hp = monster.stats.hp = 10;
-    monster.stats.attack = 3;
-    monster.stats.xp = 35;
-    monster.ai = std::make_unique<action::BasicAI>();
-    world.schedule.push_back(monster_id);
-    world.active_actors.insert(monster_id);
+  world.actors.reserve(world.actors.size() + params.orcs + params.trolls);
+  world.active_actors.reserve(world.active_actors.size() + params.orcs + params.trolls);
+  world.dormant_actors.reserve(world.dormant_actors.size() + params.orcs + params.trolls);
+  world.actor_positions.reserve(world.actor_positions.size() + params.orcs + params.trolls);
+  for (int repeats{0}; repeats < params.orcs; ++repeats) {
+    spawn_orc(world, pop_random(floor_tiles, world.rng), params.orc_stats);
   }
-  for (int repeats{0}; repeats < 4; ++repeats) {
-    auto& [monster_id, monster] = *new_actor(world);
-    monster.pos = pop_random(floor_tiles, world.rng);
-    monster.name = "troll";
-    monster.ch = 'T';
-    monster.fg = tcod::ColorRGB{0, 127, 0};
-    monster.stats.max_hp = monster.stats.hp = 16;
-    monster.stats.defense = 1;
-    monster.stats.attack = 4;
-    monster.stats.xp = 100;
-    monster.ai = std::make_unique<action::BasicAI>();
-    world.schedule.push_back(monster_id);
-    world.active_actors.insert(monster_id);
+  for (int repeats{0}; repeats < params.trolls; ++repeats) {
+    spawn_troll(world, pop_random(floor_tiles, world.rng), params.troll_stats);
   }
 
   map.fixtures[pop_random(floor_tiles, world.rng)] = Fixture{"down stairs", '>'};
 
   return map;
 }
+
+inline auto generate_level(
+    World& world, int level = 1, bool simulate_frozen = false, jobs::Scheduler* scheduler = nullptr) -> Map& {
+  return generate_level(world, level, LevelParams{}, simulate_frozen, scheduler);
+}
 }  //  namespace procgen
@@ -0,0 +1,24 @@
+#pragma once
+#include "../constants.hpp"
+
+namespace procgen {
+/// The stats of a kind of monster.
+struct MonsterStats {
+  int hp;
+  int attack;
+  int defense;
+  int xp;  // The XP given to the player for killing this monster.
+};
+
+/// Parameters for generate_level.  The defaults are the normal dungeon levels.
+struct LevelParams {
+  int width = constants::MAP_WIDTH;
+  int height = constants::MAP_HEIGHT;
+  int health_potions = 5;
+  int scrolls = 2;  // The number of each type of scroll.
+  int orcs = 20;
+  int trolls = 4;
+  MonsterStats orc_stats = {10, 3, 0, 35};
+  MonsterStats troll_stats = {16, 4, 1, 100};
+};
+}  // namespace procgen
@@ -0,0 +1,12 @@
+#pragma once
+#include <utility>
+
+#include "globals.hpp"
+#include "types/recording.hpp"
+
+namespace replay {
+/// Add `command` to the current recording, if the session is being recorded.
+inline void record(GameContext& context, Command command) {
+  if (context.recording) context.recording->commands.emplace_back(std::move(command));
+}
+}  // namespace replay
@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <libtcod.hpp>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+#include "constants.hpp"
+#include "memory_stats.hpp"
+#include "types/map.hpp"
+#include "types/render_snapshot.hpp"
+#include "types/world.hpp"
+
+/// Return the graphic for the map tile at `pos`, dimmed if it is not currently visible.  `pos` must be in bounds.
+inline auto get_map_tile(const Map& map, Position pos) -> TCOD_ConsoleTile {
+  auto tile = map.tiles[pos] == Tiles::floor
+                  ? TCOD_ConsoleTile{'.', tcod::ColorRGB{128, 128, 128}, tcod::ColorRGB{0, 0, 0}}
+                  : TCOD_ConsoleTile{'#', tcod::ColorRGB{128, 128, 128}, tcod::ColorRGB{0, 0, 0}};
+  if (!map.visible[pos]) {
+    tile.fg.r /= 2;
+    tile.fg.g /= 2;
+    tile.fg.b /= 2;
+    tile.bg.r /= 2;
+    tile.bg.g /= 2;
+    tile.bg.b /= 2;
+  }
+  return tile;
+}
+
+/// Copy what is needed to draw `world` into `snapshot`, reusing its allocations.
+/// Only the top-left `width` by `height` tiles of the active map are copied since nothing else fits on the console.
+inline void update_render_snapshot(
+    RenderSnapshot& snapshot,
+    const World& world,
+    int width = constants::CONSOLE_WIDTH,
+    int height = constants::MAP_HEIGHT,
+    int log_lines = constants::CONSOLE_HEIGHT - constants::MAP_HEIGHT) {
+  const auto& map = world.active_map();
+  const auto& player = world.active_player();
+  width = std::min(width, map.get_width());
+  height = std::min(height, map.get_height());
+
+  snapshot.turn = world.turn;
+  if (snapshot.tiles.get_shape() != std::array{width, height}) {
+    snapshot.tiles = util::Array2D<TCOD_ConsoleTile>{{width, height}};
+    snapshot.visible = util::Array2D<bool>{{width, height}};
+  }
+  snapshot.names.clear();
+  for (int y{0}; y < height; ++y) {
+    const auto tiles_row = snapshot.tiles.row(y);
+    for (int x{0}; x < width; ++x) {
+      const auto pos = Position{x, y};
+      const bool visible = map.visible[pos];
+      snapshot.visible[pos] = visible;
+      auto& tile = tiles_row[x];
+      tile = map.explored[pos] ? get_map_tile(map, pos) : TCOD_ConsoleTile{0, {}, {}};
+      if (!visible) continue;
+      if (const auto found = map.fixtures.find(pos); found != map.fixtures.end()) {
+        tile.ch = found->second.ch;
+        tile.fg = found->second.fg;
+        snapshot.names.emplace_back(pos, found->second.name);
+      }
+      for (auto [it, last] = map.items.equal_range(pos); it != last; ++it) {
+        const auto& [item_ch, item_fg] = it->second->get_graphic();
+        tile.ch = item_ch;
+        tile.fg = item_fg;
+      }
+      for (auto [it, last] = world.actor_positions.equal_range(pos); it != last; ++it) {
+        const auto& actor = world.get(it->second);
+        tile.ch = actor.ch;
+        tile.fg = actor.fg;
+        snapshot.names.emplace_back(pos, actor.name);
+      }
+    }
+  }
+
+  // Every message takes at least one line, so older messages could never be shown.
+  const auto& messages = world.log.messages;
+  const auto log_begin = messages.end() - std::min<ptrdiff_t>(log_lines, std::ssize(messages));
+  snapshot.log_tail.assign(log_begin, messages.end());
+
+  snapshot.inventory.clear();
+  for (const auto& item : player.stats.inventory) snapshot.inventory.emplace_back(item->get_name(), item->count);
+  snapshot.hp = player.stats.hp;
+  snapshot.max_hp = player.stats.max_hp;
+  snapshot.xp = player.stats.xp;
+  snapshot.level = player.stats.level;
+
+  snapshot.active_actors = world.active_actors.size();
+  snapshot.map_memory.clear();
+  for (const auto& [map_id, it] : world.maps) {
+    snapshot.map_memory.emplace_back(map_id, get_memory_footprint(it));
+  }
+  std::ranges::sort(snapshot.map_memory, {}, [](const auto& it) { return std::tie(it.first.name, it.first.level); });
+  snapshot.unloaded_maps = world.unloaded_maps.size();
+}
+
+/// Double-buffered render snapshots.
+/// The simulation fills a back buffer and publishes it while the renderer keeps drawing whatever was last published.
+/// Safe to use from one publishing thread and any number of drawing threads.
+class RenderSnapshotBuffer {
+ public:
+  /// Return a snapshot to fill, reusing the previously published buffer once nothing is drawing it.
+  [[nodiscard]] auto acquire() -> std::shared_ptr<RenderSnapshot> {
+    auto lock = std::lock_guard{mutex_};
+    if (back_ && back_.use_count() == 1) {
+      std::atomic_thread_fence(std::memory_order_acquire);  // Pairs with the release of the last drawing thread.
+      return std::exchange(back_, nullptr);
+    }
+    return std::make_shared<RenderSnapshot>();
+  }
+
+  /// Make `snapshot` the one which is drawn.
+  void publish(std::shared_ptr<RenderSnapshot> snapshot) {
+    auto lock = std::lock_guard{mutex_};
+    back_ = std::exchange(front_, std::move(snapshot));
+  }
+
+  /// Fill and publish a snapshot of `world`.
+  void publish(const World& world) {
+    const memstats::Scope memory_scope{memstats::Subsystem::rendering};
+    auto snapshot = acquire();
+    update_render_snapshot(*snapshot, world);
+    publish(std::move(snapshot));
+  }
+
+  /// Return the latest published snapshot, or null if nothing was published yet.
+  [[nodiscard]] auto get() const -> std::shared_ptr<const RenderSnapshot> {
+    auto lock = std::lock_guard{mutex_};
+    return front_;
+  }
+
+  /// Drop all snapshots, such as when the world is closed.
+  void clear() {
+    auto lock = std::lock_guard{mutex_};
+    front_ = nullptr;
+    back_ = nullptr;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::shared_ptr<RenderSnapshot> front_;  // The snapshot being drawn.
+  std::shared_ptr<RenderSnapshot> back_;  // The previously drawn snapshot, reused when no longer referenced.
+};
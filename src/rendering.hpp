@@ -7,66 +7,43 @@
 
 #include "constants.hpp"
 #include "globals.hpp"
-#include "world_logic.hpp"
+#include "memory_stats.hpp"
+#include "perf_stats.hpp"
+#include "render_snapshot.hpp"
+#include "trace.hpp"
+#include "types/ndarray.hpp"
 #include "xp.hpp"
 
 inline void render_map(tcod::Console& console, const Map& map, bool show_all = false) {
-  const int x_min = 0;
   const int x_max = std::min(console.get_width(), map.get_width());
-  const int y_min = 0;
   const int y_max = std::min(console.get_height(), map.get_height());
 
-  for (int y{y_min}; y < y_max; ++y) {
-    for (int x{x_min}; x < x_max; ++x) {
-      // Bounds check removed due to pre-calculated loops.
-      if (!show_all && !map.explored.at({x, y})) continue;
-      console.at({x, y}) = map.tiles.at({x, y}) == Tiles::floor
-                               ? TCOD_ConsoleTile{'.', tcod::ColorRGB{128, 128, 128}, tcod::ColorRGB{0, 0, 0}}
-                               : TCOD_ConsoleTile{'#', tcod::ColorRGB{128, 128, 128}, tcod::ColorRGB{0, 0, 0}};
-      if (!map.visible.at({x, y})) {
-        console.at({x, y}).fg.r /= 2;
-        console.at({x, y}).fg.g /= 2;
-        console.at({x, y}).fg.b /= 2;
-        console.at({x, y}).bg.r /= 2;
-        console.at({x, y}).bg.g /= 2;
-        console.at({x, y}).bg.b /= 2;
-      }
+  const auto console_tiles = util::Array2DView<TCOD_ConsoleTile>{console.begin(), {console.get_width(), y_max}};
+  for (int y{0}; y < y_max; ++y) {
+    const auto console_row = console_tiles.row(y);
+    for (int x{0}; x < x_max; ++x) {
+      if (!show_all && !map.explored[{x, y}]) continue;
+      console_row[x] = get_map_tile(map, {x, y});
     }
   }
 }
-inline void render_map(GameContext& context) {
-  const auto& map = context.world->active_map();
-  render_map(context.console, map);
-
-  const auto can_draw = [&](Position map_pos) {
-    if (!map.visible.in_bounds(map_pos)) return false;
-    if (!map.visible.at(map_pos)) return false;
-    if (!context.console.in_bounds(map_pos)) return false;
-    return true;
-  };
-
-  for (const auto& [fixture_pos, fixture] : map.fixtures) {
-    if (!can_draw(fixture_pos)) continue;
-    context.console.at(fixture_pos).ch = fixture.ch;
-    context.console.at(fixture_pos).fg = fixture.fg;
-  }
-
-  for (const auto& [item_pos, item] : map.items) {
-    if (!can_draw(item_pos)) continue;
-    const auto& [item_ch, item_fg] = item->get_graphic();
-    context.console.at(item_pos).ch = item_ch;
-    context.console.at(item_pos).fg = item_fg;
+inline void render_map(GameContext& context, const RenderSnapshot& snapshot) {
+  const trace::Zone trace_zone{"render_map"};
+  const int x_max = std::min(context.console.get_width(), snapshot.tiles.get_width());
+  const int y_max = std::min(context.console.get_height(), snapshot.tiles.get_height());
+  const auto console_tiles =
+      util::Array2DView<TCOD_ConsoleTile>{context.console.begin(), {context.console.get_width(), y_max}};
+  for (int y{0}; y < y_max; ++y) {
+    const auto tiles_row = snapshot.tiles.row(y).first(x_max);
+    const auto console_row = console_tiles.row(y);
+    for (int x{0}; x < x_max; ++x) {
+      if (tiles_row[x].ch) console_row[x] = tiles_row[x];  // Leave unexplored tiles blank.
+    }
   }
 
-  with_active_actors(*context.world, [&](const Actor& actor) {
-    if (!can_draw(actor.pos)) return;
-    context.console.at(actor.pos).ch = actor.ch;
-    context.console.at(actor.pos).fg = actor.fg;
-  });
-
   if (context.controller.cursor) {
     const auto& cursor = *context.controller.cursor;
-    if (context.console.in_bounds(cursor) && map.visible.in_bounds(cursor)) {
+    if (context.console.in_bounds(cursor) && snapshot.visible.in_bounds(cursor)) {
       auto& cursor_tile = context.console.at(cursor);
       cursor_tile = {cursor_tile.ch, tcod::ColorRGB{0, 0, 0}, tcod::ColorRGB{255, 255, 255}};
     }
@@ -74,7 +51,8 @@ inline void render_map(GameContext& context) {
 }
 inline void render_map() { /* Removed global overload */ }
 
-inline void render_log(GameContext& context) {
+inline void render_log(GameContext& context, const RenderSnapshot& snapshot) {
+  const trace::Zone trace_zone{"render_log"};
   const int log_x = 22;
   const int log_width = context.console.get_width() - log_x;
   const int log_height = context.console.get_height() - constants::MAP_HEIGHT;
@@ -87,7 +65,7 @@ inline void render_log(GameContext& context) {
   context.log_console.clear();  // Important to clear reused console
 
   int y = context.log_console.get_height();
-  for (auto it = context.world->log.messages.crbegin(); it != context.world->log.messages.crend(); ++it) {
+  for (auto it = snapshot.log_tail.crbegin(); it != snapshot.log_tail.crend(); ++it) {
     const auto& msg = *it;
     auto print_msg = [&](std::string_view text, const tcod::ColorRGB& fg) {
       y -= tcod::get_height_rect(context.log_console.get_width(), text);
@@ -120,23 +98,14 @@ inline void draw_bar(
   tcod::print(console, {x + width / 2, y}, label, tcod::ColorRGB{255, 255, 255}, std::nullopt, TCOD_CENTER);
 }
 
-inline void render_mouse_look(GameContext& context) {
+inline void render_mouse_look(GameContext& context, const RenderSnapshot& snapshot) {
   if (!context.controller.cursor) return;
 
-  const auto& map = context.world->active_map();
-  if (!(map.visible.in_bounds(*context.controller.cursor) && map.visible.at(*context.controller.cursor))) return;
-
   auto cursor_desc = std::vector<std::string>{};
-  if (const auto found_fixture = map.fixtures.find(*context.controller.cursor); found_fixture != map.fixtures.end()) {
-    cursor_desc.emplace_back(found_fixture->second.name);
+  for (const auto& [pos, name] : snapshot.names) {
+    if (pos == *context.controller.cursor) cursor_desc.emplace_back(name);
   }
 
-  with_active_actors(*context.world, [&](const Actor& actor) {
-    if (actor.pos == *context.controller.cursor) {
-      cursor_desc.emplace_back(actor.name);
-    }
-  });
-
   if (!cursor_desc.empty()) {
     tcod::print(
         context.console,
@@ -147,8 +116,7 @@ inline void render_mouse_look(GameContext& context) {
   }
 }
 
-inline void render_gui(GameContext& context) {
-  const auto& player = context.world->active_player();
+inline void render_gui(GameContext& context, const RenderSnapshot& snapshot) {
   const int hp_x = 1;
   const int hp_y = constants::MAP_HEIGHT + 1;
 
@@ -157,26 +125,115 @@ inline void render_gui(GameContext& context) {
       hp_x,
       hp_y,
       20,
-      static_cast<float>(player.stats.hp) / player.stats.max_hp,
+      static_cast<float>(snapshot.hp) / snapshot.max_hp,
       constants::HP_BAR_FILL,
       constants::HP_BAR_BACK,
-      fmt::format(" HP: {}/{}", player.stats.hp, player.stats.max_hp));
+      fmt::format(" HP: {}/{}", snapshot.hp, snapshot.max_hp));
   draw_bar(
       context.console,
       hp_x,
       hp_y + 1,
       20,
-      static_cast<float>(player.stats.xp) / next_level_xp(player.stats.level),
+      static_cast<float>(snapshot.xp) / next_level_xp(snapshot.level),
       constants::XP_BAR_FILL,
       constants::XP_BAR_BACK,
-      fmt::format(" XP: {}", player.stats.xp));
-  render_log(context);
-  render_mouse_look(context);
+      fmt::format(" XP: {}", snapshot.xp));
+  render_log(context, snapshot);
+  render_mouse_look(context, snapshot);
+}
+
+/// Print one row of the allocation overlay: allocations, kilobytes and peak kilobytes of a turn, then of a frame.
+inline void print_memory_stats_row(
+    tcod::Console& console,
+    int y,
+    std::string_view name,
+    const memstats::Counters& turn,
+    const memstats::Counters& frame) {
+  tcod::print(
+      console,
+      {0, y},
+      fmt::format(
+          "{:<13}{:>8}{:>9}K{:>9}K{:>8}{:>9}K",
+          name,
+          turn.allocations,
+          turn.bytes / 1024,
+          turn.peak_bytes / 1024,
+          frame.allocations,
+          frame.bytes / 1024),
+      constants::TEXT_COLOR_DEFAULT,
+      tcod::ColorRGB{0, 0, 64});
+}
+
+/// Draw what the last turn and frame allocated by subsystem, see memory_stats.hpp.
+inline void render_memory_stats(tcod::Console& console) {
+  if (!memstats::ENABLED) {
+    tcod::print(
+        console,
+        {0, 0},
+        "Allocation stats need a build with ALLOCATION_STATS.",
+        constants::TEXT_COLOR_DEFAULT,
+        tcod::ColorRGB{0, 0, 64});
+    return;
+  }
+  const auto turn = memstats::get_last(memstats::Window::turn);
+  const auto frame = memstats::get_last(memstats::Window::frame);
+  tcod::print(
+      console,
+      {0, 0},
+      fmt::format("{:<13}{:>8}{:>10}{:>10}{:>8}{:>10}", "", "turn", "bytes", "peak", "frame", "bytes"),
+      constants::TEXT_COLOR_DEFAULT,
+      tcod::ColorRGB{0, 0, 64});
+  for (size_t i{0}; i < memstats::SUBSYSTEM_COUNT; ++i) {
+    print_memory_stats_row(console, static_cast<int>(i) + 1, memstats::SUBSYSTEM_NAMES.at(i), turn.at(i), frame.at(i));
+  }
+  const int total_y = static_cast<int>(memstats::SUBSYSTEM_COUNT) + 1;
+  print_memory_stats_row(console, total_y, "total", memstats::get_total(turn), memstats::get_total(frame));
+}
+
+/// Draw the recent timings of frames, turns and saves, then memory use, on the right of the console.
+/// Timings are the last, average and worst of the recent samples in milliseconds, see perf_stats.hpp.
+inline void render_perf_stats(
+    tcod::Console& console, const perfstats::Collector& perf_stats, const RenderSnapshot& snapshot) {
+  static constexpr int WIDTH = 35;
+  const int x = console.get_width() - WIDTH;
+  int y = 0;
+  const auto print_row = [&console, x, &y](std::string_view text) {
+    tcod::print(
+        console,
+        {x, y++},
+        fmt::format("{:<{}}", text, WIDTH),
+        constants::TEXT_COLOR_DEFAULT,
+        tcod::ColorRGB{0, 0, 64});
+  };
+  print_row(fmt::format("{:<14}{:>7}{:>7}{:>7}", "ms", "last", "avg", "max"));
+  for (size_t i{0}; i < perfstats::METRIC_COUNT; ++i) {
+    const auto metric = static_cast<perfstats::Metric>(i);
+    const auto summary = perf_stats.get_summary(metric);
+    const bool part_of_turn =
+        perfstats::METRIC_WINDOWS.at(i) == perfstats::Window::turn && metric != perfstats::Metric::turn;
+    const auto name = fmt::format("{}{}", part_of_turn ? "  " : "", perfstats::METRIC_NAMES.at(i));
+    if (!summary.samples) {
+      print_row(fmt::format("{:<14}{:>7}", name, "-"));
+      continue;
+    }
+    print_row(fmt::format("{:<14}{:>7.2f}{:>7.2f}{:>7.2f}", name, summary.last, summary.average, summary.max));
+  }
+  print_row(fmt::format("{:<14}{:>7}", "active actors", snapshot.active_actors));
+  for (const auto& [map_id, bytes] : snapshot.map_memory) {
+    print_row(fmt::format("{:<14}{:>7}K", fmt::format("{} {}", map_id.name, map_id.level), bytes / 1024));
+  }
+  if (snapshot.unloaded_maps) print_row(fmt::format("{:<14}{:>7}", "unloaded maps", snapshot.unloaded_maps));
 }
 
+/// Draw the latest render snapshot.  This never reads the World, so it is safe while a turn is being simulated.
 inline void render_all(GameContext& context) {
-  render_map(context);
-  render_gui(context);
+  const memstats::Scope memory_scope{memstats::Subsystem::rendering};
+  const auto snapshot = context.snapshots.get();
+  if (!snapshot) return;
+  render_map(context, *snapshot);
+  render_gui(context, *snapshot);
+  if (context.show_memory_stats) render_memory_stats(context.console);
+  if (context.show_perf_stats) render_perf_stats(context.console, context.perf_stats, *snapshot);
 }
 
 // inline void main_redraw() { ... } // Removed
@@ -0,0 +1,252 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <variant>
+
+#include "actions/bump.hpp"
+#include "actions/pickup.hpp"
+#include "actions/use_item.hpp"
+#include "actions/use_stairs.hpp"
+#include "background_levels.hpp"
+#include "globals.hpp"
+#include "json.hpp"
+#include "procgen/caves.hpp"
+#include "recording.hpp"
+#include "serialization.hpp"
+#include "simulation.hpp"
+#include "states/levelup.hpp"
+#include "states/pick_tile.hpp"
+#include "types/recording.hpp"
+#include "xp.hpp"
+
+/*****************************************************************************
+    Recording and replaying play sessions.
+
+    A recording holds the World it started from and every command the player gave afterwards.  Replaying those
+    commands on that World must reach the same final state, which is verified with a checksum.  The live World is
+    reloaded from the recorded start when recording begins, so that the live session and any replay of it begin from
+    exactly the same state including the iteration order of hashed containers.
+ */
+namespace procgen {
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(MonsterStats, hp, attack, defense, xp);
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(
+    LevelParams, width, height, health_potions, scrolls, orcs, trolls, orc_stats, troll_stats);
+}  // namespace procgen
+
+namespace replay {
+NLOHMANN_JSON_SERIALIZE_ENUM(
+    LevelUpStat,
+    {{LevelUpStat::constitution, "constitution"},
+     {LevelUpStat::strength, "strength"},
+     {LevelUpStat::agility, "agility"}});
+
+inline void to_json(json& j, const Command& command) {
+  if (const auto* bump = std::get_if<Bump>(&command)) {
+    j = {{"type", "bump"}, {"dir", {bump->dir.x, bump->dir.y}}};
+  } else if (std::holds_alternative<Pickup>(command)) {
+    j = {{"type", "pickup"}};
+  } else if (const auto* use_item = std::get_if<UseItem>(&command)) {
+    j = {{"type", "use_item"}, {"item_index", use_item->item_index}};
+  } else if (const auto* use_stairs = std::get_if<UseStairs>(&command)) {
+    j = {{"type", "use_stairs"}, {"downwards", use_stairs->downwards}};
+  } else if (const auto* pick_tile = std::get_if<PickTile>(&command)) {
+    j = {{"type", "pick_tile"}, {"target", {pick_tile->target.x, pick_tile->target.y}}};
+  } else if (const auto* level_up = std::get_if<LevelUp>(&command)) {
+    j = {{"type", "level_up"}, {"stat", level_up->stat}};
+  } else if (std::holds_alternative<RegenerateLevel>(command)) {
+    j = {{"type", "regenerate_level"}};
+  } else if (std::holds_alternative<RevealMap>(command)) {
+    j = {{"type", "reveal_map"}};
+  }
+}
+inline void from_json(const json& j, Command& command) {
+  const auto type = j.at("type").get<std::string>();
+  const auto get_position = [&j](const char* key) {
+    return Position{j.at(key).at(0).get<int>(), j.at(key).at(1).get<int>()};
+  };
+  if (type == "bump") {
+    command = Bump{get_position("dir")};
+  } else if (type == "pickup") {
+    command = Pickup{};
+  } else if (type == "use_item") {
+    command = UseItem{j.at("item_index").get<int>()};
+  } else if (type == "use_stairs") {
+    command = UseStairs{j.at("downwards").get<bool>()};
+  } else if (type == "pick_tile") {
+    command = PickTile{get_position("target")};
+  } else if (type == "level_up") {
+    command = LevelUp{j.at("stat").get<LevelUpStat>()};
+  } else if (type == "regenerate_level") {
+    command = RegenerateLevel{};
+  } else if (type == "reveal_map") {
+    command = RevealMap{};
+  } else {
+    throw std::runtime_error("Unknown command type: " + type);
+  }
+}
+
+inline void to_json(json& j, const Recording& recording) {
+  j["version"] = Recording::VERSION;
+  j["start"] = recording.start;
+  j["simulate_frozen_levels"] = recording.simulate_frozen_levels;
+  j["level_params"] = recording.level_params;
+  j["commands"] = recording.commands;
+  j["turns"] = recording.turns;
+  j["checksum"] = recording.checksum;
+}
+inline void from_json(const json& j, Recording& recording) {
+  if (j.at("version").get<int>() != Recording::VERSION) throw std::runtime_error("Unsupported recording version.");
+  j.at("start").get_to(recording.start);
+  j.at("simulate_frozen_levels").get_to(recording.simulate_frozen_levels);
+  if (j.contains("level_params")) {
+    j.at("level_params").get_to(recording.level_params);
+  } else {
+    recording.level_params = {};  // Recorded before levels could be tuned.
+  }
+  j.at("commands").get_to(recording.commands);
+  j.at("turns").get_to(recording.turns);
+  j.at("checksum").get_to(recording.checksum);
+}
+
+/// Return a checksum of everything saved for `world`.  Levels simulated in the background must be reclaimed first.
+[[nodiscard]] inline auto world_checksum(const World& world) -> uint64_t {
+  auto j = world_to_json(world);
+  // Hashed containers, including those inside each map, are sorted so that only their contents matter.
+  for (const auto* key : {"actors", "maps", "dormant_actors"}) std::sort(j.at(key).begin(), j.at(key).end());
+  for (auto& map_pair : j.at("maps")) {
+    auto& map = map_pair.at(1);
+    for (const auto* key : {"items", "fixtures"}) std::sort(map.at(key).begin(), map.at(key).end());
+  }
+  uint64_t hash = 0xcbf29ce484222325;  // 64-bit FNV-1a.
+  for (const unsigned char c : j.dump()) hash = (hash ^ c) * 0x100000001b3;
+  return hash;
+}
+
+/// Return the Action performed by `command`, or null if the command is not an Action.
+[[nodiscard]] inline auto to_action(const Command& command) -> std::unique_ptr<action::Action> {
+  if (const auto* bump = std::get_if<Bump>(&command)) return std::make_unique<action::Bump>(bump->dir);
+  if (std::holds_alternative<Pickup>(command)) return std::make_unique<action::Pickup>();
+  if (const auto* use_item = std::get_if<UseItem>(&command)) {
+    return std::make_unique<action::UseItem>(use_item->item_index);
+  }
+  if (const auto* use_stairs = std::get_if<UseStairs>(&command)) {
+    return std::make_unique<action::UseStairs>(use_stairs->downwards);
+  }
+  return nullptr;
+}
+
+/// Start recording the session in `context.world` if a record path was given.
+/// The World is replaced with a copy loaded from the recorded start.
+inline void begin_recording(GameContext& context) {
+  if (context.record_path.empty() || !context.world) return;
+  background::reclaim_all(*context.world);
+  context.world->load_all_maps();
+  context.recording = std::make_unique<Recording>();
+  context.recording->start = world_to_json(*context.world, &context.scheduler);
+  context.recording->simulate_frozen_levels = context.simulate_frozen_levels;
+  context.recording->level_params = context.level_params;
+  auto world = std::make_unique<World>();
+  context.recording->start.get_to(*world);
+  context.world = std::move(world);
+}
+
+/// Finish the current recording and write it to the record path.  Does nothing if nothing is being recorded.
+inline void end_recording(GameContext& context) {
+  if (!context.recording) return;
+  auto recording = std::move(context.recording);
+  if (context.world) {
+    background::reclaim_all(*context.world);
+    recording->turns = context.world->turn;
+    recording->checksum = world_checksum(*context.world);
+  }
+  if (context.record_path.has_parent_path()) std::filesystem::create_directories(context.record_path.parent_path());
+  std::ofstream{context.record_path} << json(*recording) << "\n";
+  std::cout << "Recorded " << recording->commands.size() << " commands to " << context.record_path << "\n";
+}
+
+[[nodiscard]] inline auto load_recording(const std::filesystem::path& path) -> Recording {
+  return json::parse(std::ifstream{path}).get<Recording>();
+}
+
+/// Perform `command` the same way the SDL callbacks and InGame state would, but without any states or drawing.
+/// `picking` keeps the state which is waiting for a PickTile command.  Returns true if a turn was taken.
+inline auto execute(GameContext& context, const Command& command, std::unique_ptr<state::State>& picking) -> bool {
+  auto& world = *context.world;
+  const auto end_turn = [&context, &world]() {
+    if (world.active_player().stats.hp <= 0) return;  // The Dead state is entered instead.
+    advance_turn(context);
+    if (world.active_player().stats.xp >= next_level_xp(world.active_player().stats.level)) {
+      std::ignore = state::LevelUp{context};  // Logs the level up, the stat comes from a later LevelUp command.
+    }
+  };
+
+  if (auto action = to_action(command)) {
+    auto result = action->perform(context, world.active_player());
+    if (const auto* failure = std::get_if<action::Failure>(&result)) {
+      world.log.append(failure->reason);
+      return false;
+    }
+    if (auto* poll = std::get_if<action::Poll>(&result)) {
+      picking = std::move(poll->new_state);
+      return false;
+    }
+    end_turn();
+    return true;
+  }
+  if (const auto* pick_tile = std::get_if<PickTile>(&command)) {
+    auto* pick_state = dynamic_cast<state::PickTile*>(picking.get());
+    if (!pick_state) throw std::runtime_error("A tile was picked without anything to pick it for.");
+    const bool took_turn = std::holds_alternative<state::EndTurn>(pick_state->pick(context, pick_tile->target));
+    picking = nullptr;
+    if (took_turn) end_turn();
+    return took_turn;
+  }
+  if (const auto* level_up = std::get_if<LevelUp>(&command)) {
+    ::level_up(world.active_player().stats, level_up->stat);
+  } else if (std::holds_alternative<RegenerateLevel>(command)) {
+    procgen::generate_level(world, 1, context.level_params, context.simulate_frozen_levels, &context.scheduler);
+  } else if (std::holds_alternative<RevealMap>(command)) {
+    for (auto&& it : world.active_map().explored) it = true;
+    world.active_map().dirty = true;
+  }
+  return false;
+}
+
+/// The outcome of `play`.
+struct Report {
+  size_t commands = 0;
+  int turns = 0;  // Turns simulated by the replay.
+  double seconds = 0;  // Wall time spent replaying, not including loading the starting World.
+  uint64_t checksum = 0;  // The world_checksum after the replay.
+  bool matches = false;  // True if the replay ended in the recorded state.
+
+  [[nodiscard]] auto turns_per_second() const noexcept -> double { return seconds > 0 ? turns / seconds : 0; }
+};
+
+/// Replay `recording` into `context.world` without a window, as fast as possible.
+inline auto play(GameContext& context, const Recording& recording) -> Report {
+  context.world = std::make_unique<World>();
+  recording.start.get_to(*context.world);
+  context.simulate_frozen_levels = recording.simulate_frozen_levels;
+  context.level_params = recording.level_params;
+  auto& world = *context.world;
+  const int start_turn = world.turn;
+
+  const auto start_time = std::chrono::steady_clock::now();
+  auto picking = std::unique_ptr<state::State>{};
+  for (const auto& command : recording.commands) std::ignore = execute(context, command, picking);
+  background::reclaim_all(world);
+  auto report = Report{};
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  report.commands = recording.commands.size();
+  report.turns = world.turn - start_turn;
+  report.checksum = world_checksum(world);
+  report.matches = report.checksum == recording.checksum && world.turn == recording.turns;
+  return report;
+}
+}  // namespace replay
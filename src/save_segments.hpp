@@ -0,0 +1,228 @@
+#pragma once
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "background_levels.hpp"
+#include "binary_io.hpp"
+#include "binary_save.hpp"
+#include "jobs.hpp"
+#include "mapped_file.hpp"
+#include "memory_stats.hpp"
+#include "perf_stats.hpp"
+#include "save_writer.hpp"
+#include "trace.hpp"
+#include "types/map.hpp"
+#include "types/world.hpp"
+
+/*****************************************************************************
+    Incremental saves split into segment files.
+
+    A save directory holds one segment for the World without its maps, one segment per map, and a manifest naming
+    the segments of the latest save.  Only maps marked dirty are encoded and written again; clean maps keep pointing
+    at the segment they were last saved to.  Actors frozen in a map are stored in that map's segment, so levels the
+    player left long ago cost nothing to save.
+
+    Every file is written to a temporary name and renamed into place.  Segment names include the save generation, so
+    a save never overwrites a segment the previous manifest uses.  Renaming the manifest commits the save, after which
+    segments no longer referenced are deleted.  A save interrupted at any point leaves the previous save loadable.
+
+    Loading only decodes the current map.  Other maps are listed in World::unloaded_maps and decoded from their
+    memory-mapped segment the first time World::find_map asks for them.  Saves keep referencing the segments of maps
+    which were never loaded.  The manifest lists the actors frozen in each map, so that their IDs stay reserved in
+    World::unloaded_actors until the map is decoded.
+ */
+namespace save {
+inline constexpr auto MANIFEST_MAGIC = std::array<char, 4>{'R', 'L', 'M', 'F'};
+inline constexpr auto WORLD_MAGIC = std::array<char, 4>{'R', 'L', 'S', 'W'};
+inline constexpr auto MAP_MAGIC = std::array<char, 4>{'R', 'L', 'S', 'M'};
+
+[[nodiscard]] inline auto read_file(const std::filesystem::path& path) -> std::vector<char> {
+  auto file = std::ifstream{path, std::ios::binary};
+  if (!file) throw std::runtime_error("Could not open " + path.string());
+  return std::vector<char>{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+/// Return the segment file name for `map_id` in save `generation`.
+[[nodiscard]] inline auto get_segment_name(const MapID& map_id, uint64_t generation) -> std::string {
+  auto name = map_id.name;
+  std::ranges::replace_if(name, [](unsigned char c) { return !std::isalnum(c); }, '_');
+  return fmt::format("{}.{}.g{}.seg", name, map_id.level, generation);
+}
+
+/// Return the generation of the save in `directory`, or 0 if there is none.
+[[nodiscard]] inline auto read_generation(const std::filesystem::path& directory) -> uint64_t {
+  if (!std::filesystem::exists(directory / MANIFEST_NAME)) return 0;
+  const auto data = read_file(directory / MANIFEST_NAME);
+  auto in = binary::read_header(std::as_bytes(std::span{data}), MANIFEST_MAGIC);
+  return in.read_varint();
+}
+
+/// Encode the parts of `world` which changed since it was last saved.  Maps are encoded in parallel with a scheduler.
+/// The active map is always encoded since its field of view changes every turn.
+[[nodiscard]] inline auto plan_save(const World& world, uint64_t generation, jobs::Scheduler* scheduler = nullptr)
+    -> SavePlan {
+  const trace::Zone trace_zone{"plan_save"};
+  const perfstats::Timer timer{perfstats::Metric::save};
+  const memstats::Scope memory_scope{memstats::Subsystem::serialization};
+  auto plan = SavePlan{};
+  plan.generation = generation;
+  auto frozen_actors = std::unordered_set<ActorID>{};
+  auto dirty_maps = std::vector<const Map*>{};
+  for (const auto& [map_id, map] : world.maps) {
+    frozen_actors.insert(map.frozen_actors.begin(), map.frozen_actors.end());
+    if (map.dirty || map.segment.empty() || map_id == world.current_map_id) {
+      dirty_maps.emplace_back(&map);
+      plan.map_segments.emplace_back(map_id, get_segment_name(map_id, generation));
+    } else {
+      plan.map_segments.emplace_back(map_id, map.segment);
+    }
+  }
+  // Maps never loaded since the save was loaded are unchanged, and so are the actors frozen in them.
+  for (const auto& [map_id, unloaded] : world.unloaded_maps) plan.map_segments.emplace_back(map_id, unloaded.segment);
+
+  plan.segments.resize(dirty_maps.size() + 1);
+  jobs::parallel_for(scheduler, 0, static_cast<int>(dirty_maps.size()), 1, [&](int i) {
+    const memstats::Scope memory_scope{memstats::Subsystem::serialization};
+    const auto& map = *dirty_maps.at(i);
+    auto out = binary::Writer{};
+    binary::write_header(out, MAP_MAGIC);
+    binary::write_map_id(out, map.id);
+    binary::write_map(out, map);
+    binary::write_frozen_actors(out, world, map);
+    plan.segments.at(i) = {get_segment_name(map.id, generation), out.release()};
+  });
+  auto world_out = binary::Writer{};
+  binary::write_header(world_out, WORLD_MAGIC);
+  binary::write_world_state(world_out, world, frozen_actors);
+  const auto world_segment = fmt::format("world.g{}.seg", generation);
+  plan.segments.back() = {world_segment, world_out.release()};
+
+  auto manifest = binary::Writer{};
+  binary::write_header(manifest, MANIFEST_MAGIC);
+  manifest.write_varint(generation);
+  manifest.write_string(world_segment);
+  manifest.write_varint(plan.map_segments.size());
+  for (const auto& [map_id, segment] : plan.map_segments) {
+    binary::write_map_id(manifest, map_id);
+    manifest.write_string(segment);
+    const auto loaded = world.maps.find(map_id);
+    const auto& map_actors =
+        loaded != world.maps.end() ? loaded->second.frozen_actors : world.unloaded_maps.at(map_id).frozen_actors;
+    manifest.write_varint(map_actors.size());
+    for (const auto actor_id : map_actors) binary::write_actor_id(manifest, actor_id);
+  }
+  plan.manifest = manifest.release();
+  return plan;
+}
+
+/// Mark the maps of `world` as saved by `plan`.  Call once the plan was written.
+inline void mark_saved(World& world, const SavePlan& plan) {
+  for (const auto& [map_id, segment] : plan.map_segments) {
+    auto map = world.maps.find(map_id);
+    if (map == world.maps.end()) continue;
+    map->second.segment = segment;
+    map->second.dirty = false;
+  }
+}
+
+/// Save `world` into `directory`, only writing what changed since the last save.
+inline void save_incremental(
+    World& world, const std::filesystem::path& directory, jobs::Scheduler* scheduler = nullptr) {
+  const auto plan = plan_save(world, read_generation(directory) + 1, scheduler);
+  {
+    const perfstats::Timer timer{perfstats::Metric::save};
+    write_save(directory, plan);
+  }
+  perfstats::end_window(perfstats::Window::save);
+  mark_saved(world, plan);
+}
+
+/// Snapshot the changes to `world` and queue them on `writer`, returning before anything is written.
+/// Levels simulated in the background are paused while their actors are encoded, then continue where they left off.
+inline void save_in_background(SaveWriter& writer, World& world, jobs::Scheduler* scheduler = nullptr) {
+  const auto generation = writer.get_generation() ? writer.get_generation() : read_generation(writer.get_directory());
+  if (writer.take_failure()) {
+    for (auto& [map_id, map] : world.maps) map.dirty = true;  // The failed save may have missed any of them.
+  }
+  auto paused = background::pause_all(world);
+  auto plan = plan_save(world, generation + 1, scheduler);
+  background::resume_all(world, std::move(paused), scheduler);
+  mark_saved(world, plan);  // Changes from now on go into the next save.
+  writer.queue(std::move(plan));
+}
+
+/// Decode the map segment `data` into `world`, checking that it holds `map_id`.  The map is loaded clean.
+inline void read_map_segment(
+    std::span<const std::byte> data, World& world, const MapID& map_id, const std::string& segment) {
+  auto in = binary::read_header(data, MAP_MAGIC);
+  if (binary::read_map_id(in) != map_id) throw binary::DecodeError("Segment does not match the manifest.");
+  auto& map = world.maps[map_id] = binary::read_map(in);
+  binary::read_actors(in, world);
+  map.id = map_id;
+  map.segment = segment;
+  map.dirty = false;
+}
+
+/// Decodes maps on first use from the segments of a save directory, which are memory-mapped instead of read.
+class SegmentLoader : public MapLoader {
+ public:
+  explicit SegmentLoader(std::filesystem::path directory) : directory_{std::move(directory)} {}
+  auto load(World& world, const MapID& map_id, const std::string& segment) -> void override {
+    const memstats::Scope memory_scope{memstats::Subsystem::serialization};
+    const auto file = MappedFile::open_readonly(directory_ / segment);
+    read_map_segment({file.data(), file.size()}, world, map_id, segment);
+  }
+
+ private:
+  std::filesystem::path directory_;
+};
+
+/// Load the save in `directory`.  Only the current map is decoded, other maps are decoded on first use through
+/// World::find_map, so loading takes the same time however many levels were visited.
+/// The save directory must not be changed by anything except saves of the loaded World until every map is loaded.
+[[nodiscard]] inline auto load_incremental(const std::filesystem::path& directory) -> std::unique_ptr<World> {
+  const memstats::Scope memory_scope{memstats::Subsystem::serialization};
+  const auto manifest_data = read_file(directory / MANIFEST_NAME);
+  auto version = uint64_t{};
+  auto manifest = binary::read_header(std::as_bytes(std::span{manifest_data}), MANIFEST_MAGIC, &version);
+  std::ignore = manifest.read_varint();  // Generation.
+  auto world = std::make_unique<World>();
+  {
+    const auto data = read_file(directory / manifest.read_string());
+    auto in = binary::read_header(std::as_bytes(std::span{data}), WORLD_MAGIC);
+    binary::read_world_state(in, *world);
+  }
+  for (size_t i{0}, count{manifest.read_size()}; i < count; ++i) {
+    auto map_id = binary::read_map_id(manifest);
+    auto unloaded = UnloadedMap{manifest.read_string(), {}};
+    if (version >= 2) {
+      unloaded.frozen_actors.resize(manifest.read_size());
+      for (auto& actor_id : unloaded.frozen_actors) actor_id = binary::read_actor_id(manifest);
+      world->unloaded_actors.insert(unloaded.frozen_actors.begin(), unloaded.frozen_actors.end());
+    }
+    world->unloaded_maps.emplace(std::move(map_id), std::move(unloaded));
+  }
+  world->map_loader = std::make_unique<SegmentLoader>(directory);
+  world->find_map(world->current_map_id);
+  // Version 1 manifests do not list frozen actors, their IDs are only known once every map is decoded.
+  if (version < 2) world->load_all_maps();
+  binary::finish_loading(*world);
+  return world;
+}
+}  // namespace save
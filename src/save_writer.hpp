@@ -0,0 +1,213 @@
+#pragma once
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif  // __EMSCRIPTEN__
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "perf_stats.hpp"
+#include "trace.hpp"
+#include "types/map_id.hpp"
+
+/*****************************************************************************
+    Writing saves without blocking the game.
+
+    A SavePlan is a snapshot of everything which changed, already encoded, see save_segments.hpp.  Since the plan
+    owns its bytes the World may change as soon as the plan is made, while SaveWriter puts it on disk from a writer
+    thread.  Plans are written in the order they were queued.  Finished saves are reported back through `poll`,
+    which the main loop calls each frame.  A failed save is only acted on by the next `save_in_background`, when the
+    World is known to be idle.
+
+    Without threads (Emscripten) plans are written as soon as they are queued.  Either way the filesystem is synced
+    after each save, so callers never deal with FS.syncfs themselves.
+ */
+namespace save {
+inline constexpr auto MANIFEST_NAME = "manifest";
+inline const auto DEFAULT_DIRECTORY = std::filesystem::path{"saves/save"};  // Where the game is saved.
+
+/// An encoded segment file.
+struct Segment {
+  std::string name;
+  std::vector<std::byte> data;
+};
+
+/// Everything to write for one save.  Building this only reads the World, writing it does not touch the World.
+struct SavePlan {
+  uint64_t generation = 0;
+  std::vector<Segment> segments;  // New segment files.
+  std::vector<std::byte> manifest;
+  std::vector<std::pair<MapID, std::string>> map_segments;  // The segment of every map once this save is written.
+};
+
+/// The outcome of writing one SavePlan.
+struct SaveResult {
+  uint64_t generation = 0;
+  std::string error;  // Empty if the save was written.
+};
+
+/// Write `data` to `path` through a temporary file, so that `path` is either the old or the new file.
+inline void write_file_atomic(const std::filesystem::path& path, std::span<const std::byte> data) {
+  auto temp_path = path;
+  temp_path += ".tmp";
+  {
+    auto file = std::ofstream{temp_path, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file.flush()) throw std::runtime_error("Could not write " + temp_path.string());
+  }
+  std::filesystem::rename(temp_path, path);
+}
+
+/// Flush saves to persistent storage where the filesystem is only held in memory.
+inline void sync_filesystem() {
+#ifdef __EMSCRIPTEN__
+  // clang-format off
+  EM_ASM(
+    FS.syncfs(false, function (err) {
+      assert(!err);
+      console.log("SyncFS finished.");
+    });
+  );
+  // clang-format on
+#endif
+}
+
+/// Write `plan` into `directory` and delete the segments which the new manifest no longer uses.
+/// Throws without committing the save if a segment it keeps from an earlier save is missing.
+inline void write_save(const std::filesystem::path& directory, const SavePlan& plan) {
+  const trace::Zone trace_zone{"write_save"};
+  std::filesystem::create_directories(directory);
+  for (const auto& segment : plan.segments) write_file_atomic(directory / segment.name, segment.data);
+  for (const auto& [map_id, segment] : plan.map_segments) {
+    if (!std::filesystem::exists(directory / segment)) throw std::runtime_error("Missing save segment " + segment);
+  }
+  write_file_atomic(directory / MANIFEST_NAME, plan.manifest);  // Commits the save.
+
+  auto live = std::unordered_set<std::string>{MANIFEST_NAME};
+  for (const auto& segment : plan.segments) live.emplace(segment.name);
+  for (const auto& [map_id, segment] : plan.map_segments) live.emplace(segment);
+  for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+    if (!live.contains(entry.path().filename().string())) std::filesystem::remove(entry.path());
+  }
+}
+
+/// Writes SavePlans into a directory on a writer thread.  All methods must be called from one thread.
+class SaveWriter {
+ public:
+  SaveWriter() : SaveWriter{DEFAULT_DIRECTORY} {}
+  explicit SaveWriter(std::filesystem::path directory) : directory_{std::move(directory)} {}
+  SaveWriter(const SaveWriter&) = delete;
+  SaveWriter& operator=(const SaveWriter&) = delete;
+  /// Finishes writing every queued save.
+  ~SaveWriter() {
+    {
+      auto lock = std::unique_lock{mutex_};
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) worker_.join();
+  }
+
+  /// Queue `plan` to be written.  This never waits for the filesystem.
+  /// The time spent writing goes to the current perfstats collector of the calling thread.
+  void queue(SavePlan plan) {
+    generation_ = plan.generation;
+#ifdef __EMSCRIPTEN__
+    finished_.emplace_back(write(directory_, plan));  // Not built with threads.
+#else
+    {
+      auto lock = std::unique_lock{mutex_};
+      perf_stats_ = perfstats::get_current();
+      queue_.emplace_back(std::move(plan));
+      if (!worker_.joinable()) worker_ = std::thread{[this]() { run(); }};
+    }
+    wake_.notify_all();
+#endif
+  }
+
+  /// Block until every queued save is written.  Must be called before the save directory is read or deleted.
+  void wait() {
+    auto lock = std::unique_lock{mutex_};
+    idle_.wait(lock, [this]() { return queue_.empty() && !writing_; });
+  }
+
+  /// Return the saves finished since the last call, oldest first.
+  /// This never touches the World, so it can be called while a turn is being simulated.  Failures are also
+  /// remembered until `take_failure`, since the maps they missed must be written again by the next save.
+  [[nodiscard]] auto poll() -> std::vector<SaveResult> {
+    auto finished = std::vector<SaveResult>{};
+    {
+      auto lock = std::unique_lock{mutex_};
+      finished.swap(finished_);
+    }
+    if (std::ranges::any_of(finished, [](const SaveResult& it) { return !it.error.empty(); })) failed_ = true;
+    return finished;
+  }
+
+  /// Return true if a save failed since the last call, clearing the failure.
+  [[nodiscard]] auto take_failure() noexcept -> bool { return std::exchange(failed_, false); }
+
+  [[nodiscard]] auto get_directory() const noexcept -> const std::filesystem::path& { return directory_; }
+  /// Return the generation of the latest queued save, or 0 if nothing was queued.
+  [[nodiscard]] auto get_generation() const noexcept -> uint64_t { return generation_; }
+
+ private:
+  [[nodiscard]] static auto write(const std::filesystem::path& directory, const SavePlan& plan) -> SaveResult {
+    auto result = SaveResult{plan.generation, {}};
+    try {
+      const perfstats::Timer timer{perfstats::Metric::save};
+      write_save(directory, plan);
+      sync_filesystem();
+    } catch (const std::exception& exc) {
+      result.error = exc.what();
+    }
+    perfstats::end_window(perfstats::Window::save);
+    return result;
+  }
+
+  void run() {
+    auto lock = std::unique_lock{mutex_};
+    while (true) {
+      wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) return;  // Stopping, and everything queued was written.
+      const auto plan = std::move(queue_.front());
+      queue_.pop_front();
+      writing_ = true;
+      const perfstats::Scope perf_scope{perf_stats_};
+      lock.unlock();
+      auto result = write(directory_, plan);
+      lock.lock();
+      writing_ = false;
+      finished_.emplace_back(std::move(result));
+      idle_.notify_all();
+    }
+  }
+
+  const std::filesystem::path directory_;
+  uint64_t generation_ = 0;  // Only used by the thread queuing saves.
+  bool failed_ = false;  // Only used by the thread queuing saves.
+  std::mutex mutex_;  // Guards everything below.
+  std::condition_variable wake_;  // Signals the writer that a plan was queued or that it should stop.
+  std::condition_variable idle_;  // Signals `wait` that a plan was written.
+  std::deque<SavePlan> queue_;
+  std::vector<SaveResult> finished_;
+  bool writing_ = false;
+  bool stopping_ = false;
+  perfstats::Collector* perf_stats_ = nullptr;  // Where the writer thread's timings go, see `queue`.
+  std::thread worker_;
+};
+}  // namespace save
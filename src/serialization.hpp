@@ -1,20 +1,27 @@
 #pragma once
-#ifdef __EMSCRIPTEN__
-#include <emscripten.h>
-#endif  // __EMSCRIPTEN__
-
+#include <array>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <libtcod/color.hpp>
+#include <memory>
+#include <span>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-#include "actions/ai_basic.hpp"
-#include "items/health_potion.hpp"
-#include "items/scroll_confusion.hpp"
-#include "items/scroll_fireball.hpp"
-#include "items/scroll_lightning.hpp"
+#include "actor_index.hpp"
+#include "binary_save.hpp"
+#include "jobs.hpp"
 #include "json.hpp"
+#include "memory_stats.hpp"
+#include "save_segments.hpp"
+#include "trace.hpp"
+#include "type_registry.hpp"
 #include "types/actor.hpp"
 #include "types/fixture.hpp"
 #include "types/item.hpp"
@@ -37,69 +44,20 @@ inline void from_json(const json& j, Position& pos) {
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Fixture, name, ch, fg);
 
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(HealthPotion, count);
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ConfusionScroll, count, confuse_turns);
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(FireballScroll, count, range_squared, atk_damage);
-NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(LightningScroll, count, range_squared, atk_damage);
-
-inline void to_json(json& j, const std::unique_ptr<Item>& item) {
-  if (const auto* known = dynamic_cast<const HealthPotion*>(item.get()); known) {
-    j["type"] = "HealthPotion";
-    j["data"] = *known;
-    return;
-  }
-  if (const auto* known = dynamic_cast<const ConfusionScroll*>(item.get()); known) {
-    j["type"] = "ConfusionScroll";
-    j["data"] = *known;
-    return;
-  }
-  if (const auto* known = dynamic_cast<const FireballScroll*>(item.get()); known) {
-    j["type"] = "FireballScroll";
-    j["data"] = *known;
-    return;
-  }
-  if (const auto* known = dynamic_cast<const LightningScroll*>(item.get()); known) {
-    j["type"] = "LightningScroll";
-    j["data"] = *known;
-    return;
-  }
-  assert(0);
-}
-inline void from_json(const json& j, std::unique_ptr<Item>& item) {
-  auto name = j.at("type").get<std::string>();
-  if (name == "HealthPotion") {
-    item = std::make_unique<HealthPotion>(j.at("data").get<HealthPotion>());
-  } else if (name == "ConfusionScroll") {
-    item = std::make_unique<ConfusionScroll>(j.at("data").get<ConfusionScroll>());
-  } else if (name == "FireballScroll") {
-    item = std::make_unique<FireballScroll>(j.at("data").get<FireballScroll>());
-  } else if (name == "LightningScroll") {
-    item = std::make_unique<LightningScroll>(j.at("data").get<LightningScroll>());
-  } else {
-    assert(0);
-  }
-}
+inline void to_json(json& j, const std::unique_ptr<Item>& item) { get_item_types().to_json(j, *item); }
+inline void from_json(const json& j, std::unique_ptr<Item>& item) { item = get_item_types().from_json(j); }
 
 namespace action {
-inline void to_json(json& j, const std::unique_ptr<Action>& item) {
-  if (!item) {
+inline void to_json(json& j, const std::unique_ptr<Action>& ai) {
+  if (!ai) {
     j = nullptr;
     return;
   }
-  if (const auto* known = dynamic_cast<const BasicAI*>(item.get()); known) {
-    j["type"] = "BasicAI";
-    return;
-  }
-  assert(0);
+  get_ai_types().to_json(j, *ai);
 }
-inline void from_json(const json& j, std::unique_ptr<Action>& item) {
+inline void from_json(const json& j, std::unique_ptr<Action>& ai) {
   if (j.is_null()) return;
-  auto name = j.at("type").get<std::string>();
-  if (name == "BasicAI") {
-    item = std::make_unique<BasicAI>();
-  } else {
-    assert(0);
-  }
+  ai = get_ai_types().from_json(j);
 }
 }  // namespace action
 
@@ -155,10 +113,8 @@ inline void to_json(json& j, const Map& map) {
   j["fixtures"] = map.fixtures;
   j["frozen_actors"] = map.frozen_actors;
 }
-inline void from_json(const json& j, Map& map) {
-  j.at("tiles").get_to(map.tiles);
-  j.at("explored").get_to(map.explored);
-  j.at("visible").get_to(map.visible);
+/// Read everything of a Map except its tile layers.
+inline void map_fields_from_json(const json& j, Map& map) {
   auto items = j.at("items").get<std::vector<std::pair<Position, std::unique_ptr<Item>>>>();
   while (items.size()) {
     map.items.emplace(std::move(items.back()));
@@ -167,33 +123,70 @@ inline void from_json(const json& j, Map& map) {
   if (j.contains("fixtures")) j.at("fixtures").get_to(map.fixtures);
   if (j.contains("frozen_actors")) j.at("frozen_actors").get_to(map.frozen_actors);
 }
+inline void from_json(const json& j, Map& map) {
+  j.at("tiles").get_to(map.tiles);
+  j.at("explored").get_to(map.explored);
+  j.at("visible").get_to(map.visible);
+  map_fields_from_json(j, map);
+}
 
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Message, text, fg, count);
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(MessageLog, messages);
 
-inline void to_json(json& j, const World& world) {
+/// Return `world` as JSON.  With a scheduler the actors and each map are encoded as parallel tasks.
+inline auto world_to_json(const World& world, jobs::Scheduler* scheduler = nullptr) -> json {
+  if (!world.unloaded_maps.empty()) throw std::logic_error("Maps must be loaded before the world is encoded.");
+  json j{};
+  auto maps = std::vector<std::pair<const MapID*, const Map*>>{};
+  for (const auto& [map_id, map] : world.maps) maps.emplace_back(&map_id, &map);
+  auto encoded_maps = std::vector<json>(maps.size());
+  auto encoded_actors = json{};
+
+  auto graph = jobs::TaskGraph{};
+  std::vector<jobs::TaskGraph::NodeID> encoders;
+  encoders.emplace_back(graph.add([&world, &encoded_actors]() { encoded_actors = world.actors; }));
+  for (size_t i{0}; i < maps.size(); ++i) {
+    encoders.emplace_back(graph.add([&maps, &encoded_maps, i]() {
+      encoded_maps.at(i) = json::array({*maps.at(i).first, *maps.at(i).second});
+    }));
+  }
+  graph.add(
+      [&j, &encoded_actors, &encoded_maps]() {
+        j["actors"] = std::move(encoded_actors);
+        // Matches how nlohmann encodes a map with non-string keys, as an array of [key, value] pairs.
+        j["maps"] = std::move(encoded_maps);
+      },
+      encoders);
+  if (scheduler) {
+    graph.run(*scheduler);
+  } else {
+    auto serial = jobs::Scheduler{};  // Without workers every task runs on this thread.
+    graph.run(serial);
+  }
+
   std::stringstream rng{};
   rng << world.rng;
-  j["actors"] = world.actors;
-  j["maps"] = world.maps;
   j["rng"] = rng.str();
+  j["turn"] = world.turn;
   j["schedule"] = world.schedule;
+  j["dormant_actors"] = world.dormant_actors;
   j["log"] = world.log;
   j["current_map"] = world.current_map_id;
+  return j;
 }
 
-inline void from_json(const json& j, World& world) {
-  j.at("actors").get_to(world.actors);
-  for (auto& [actor_id, actor] : world.actors) actor.id = actor_id;
+inline void to_json(json& j, const World& world) { j = world_to_json(world); }
+
+/// Read everything of a World except its actors and maps, which must already be loaded.
+inline void world_fields_from_json(const json& j, World& world) {
   if (!j.contains("current_map")) {  // Migrate.
-    j.at("maps").at("main").get_to(world.maps[{"caves", 0}]);
     world.current_map_id = {"caves", 0};
   } else {
-    j.at("maps").get_to(world.maps);
     j.at("current_map").get_to(world.current_map_id);
   }
   for (auto& [map_id, map] : world.maps) map.id = map_id;
   std::stringstream{j.at("rng").get<std::string>()} >> world.rng;
+  if (j.contains("turn")) j.at("turn").get_to(world.turn);  // Migration.
   j.at("schedule").get_to(world.schedule);
   j.at("log").get_to(world.log);
   if (!j.contains("active_actors")) {  // Migrate.
@@ -201,46 +194,283 @@ inline void from_json(const json& j, World& world) {
   } else {
     j.at("active_actors").get_to(world.active_actors);
   }
+  if (j.contains("dormant_actors")) j.at("dormant_actors").get_to(world.dormant_actors);  // Migration.
+  for (auto id : world.dormant_actors) world.active_actors.emplace(id);
+  reindex_actors(world);
 }
 
-inline auto save_world(const World& world, std::filesystem::path path) -> void {
-  json data{};
-  data["world"] = world;
-  std::ofstream f{path};
-  f << data << "\n";
+inline void from_json(const json& j, World& world) {
+  j.at("actors").get_to(world.actors);
+  for (auto& [actor_id, actor] : world.actors) actor.id = actor_id;
+  if (!j.contains("current_map")) {  // Migrate.
+    j.at("maps").at("main").get_to(world.maps[{"caves", 0}]);
+  } else {
+    j.at("maps").get_to(world.maps);
+  }
+  world_fields_from_json(j, world);
+}
+
+/// Loads a World from a JSON save while it is parsed, without building a json value for the whole document.
+///
+/// Each actor and each map is built as a json value of its own and converted by the from_json functions above, so
+/// their migrations still apply, then discarded.  The tile layers of maps, which are most of a save, skip the json
+/// values and are decoded straight into their containers.  The remaining small fields of the World are collected and
+/// read by world_fields_from_json once parsing is done.
+class JsonWorldReader : public nlohmann::json_sax<json> {
+ public:
+  explicit JsonWorldReader(World& world) : world_{world} {}
+
+  auto null() -> bool override { return add(nullptr); }
+  auto boolean(bool value) -> bool override { return add(value); }
+  auto number_integer(json::number_integer_t value) -> bool override { return add(value); }
+  auto number_unsigned(json::number_unsigned_t value) -> bool override { return add(value); }
+  auto number_float(json::number_float_t value, const json::string_t&) -> bool override { return add(value); }
+  auto string(json::string_t& value) -> bool override { return add(std::move(value)); }
+  auto binary(json::binary_t& value) -> bool override { return add(std::move(value)); }
+  auto start_object(size_t) -> bool override { return start(json::object()); }
+  auto start_array(size_t) -> bool override { return start(json::array()); }
+  auto key(json::string_t& key) -> bool override {
+    stack_.back().key = std::move(key);
+    return true;
+  }
+  auto end_object() -> bool override { return end(); }
+  auto end_array() -> bool override { return end(); }
+  auto parse_error(size_t, const std::string&, const nlohmann::detail::exception& error) -> bool override {
+    throw std::runtime_error(error.what());
+  }
+
+  /// Read the collected fields of the World.  Call once the whole save was parsed.
+  void finish() {
+    if (!found_world_) throw std::runtime_error("The save has no world.");
+    world_fields_from_json(rest_, world_);
+  }
+
+ private:
+  enum class Kind {
+    skip,  // Ignored along with everything inside it.
+    root,  // The top level object, holding "world".
+    world,  // The World object.
+    actors,  // The array of [ActorID, Actor] pairs.
+    maps,  // The array of [MapID, Map] pairs, or an object of maps from before MapID.
+    build,  // Built into a json value.
+    tiles,  // The values of a tile layer.
+    explored,
+    visible,
+  };
+  struct Frame {
+    Kind kind;
+    json* value = nullptr;  // The json value being built for Kind::build.
+    std::string key;  // The key of the next value if this is an object.
+  };
+
+  /// Return where a new value goes, or nullptr if it is not built.  Sets `kind` to how a new container is handled.
+  auto place(json&& value, Kind& kind) -> json* {
+    kind = Kind::skip;
+    if (stack_.empty()) {
+      kind = Kind::root;
+      return nullptr;
+    }
+    auto& parent = stack_.back();
+    switch (parent.kind) {
+      case Kind::root:
+        if (parent.key == "world") kind = Kind::world;
+        found_world_ |= parent.key == "world";
+        return nullptr;
+      case Kind::world:
+        if (parent.key == "actors") {
+          kind = Kind::actors;
+          return nullptr;
+        }
+        if (parent.key == "maps") {
+          kind = Kind::maps;
+          legacy_maps_ = value.is_object();
+          return nullptr;
+        }
+        kind = Kind::build;
+        return &(rest_[parent.key] = std::move(value));
+      case Kind::actors:
+      case Kind::maps:
+        if (parent.kind == Kind::maps && legacy_maps_ && parent.key != "main") return nullptr;  // Only "main" was used.
+        fragment_kind_ = parent.kind;
+        kind = Kind::build;
+        return &(fragment_ = std::move(value));
+      case Kind::build:
+        if (fragment_kind_ == Kind::maps && value.is_array() && parent.key == "data") {
+          const auto& layer = stack_.at(stack_.size() - 2).key;  // The map's key for the Array2D holding "data".
+          if (layer == "tiles") kind = Kind::tiles;
+          if (layer == "explored") kind = Kind::explored;
+          if (layer == "visible") kind = Kind::visible;
+          if (kind != Kind::skip) return nullptr;
+        }
+        kind = Kind::build;
+        if (parent.value->is_array()) {
+          parent.value->push_back(std::move(value));
+          return &parent.value->back();
+        }
+        return &((*parent.value)[parent.key] = std::move(value));
+      default:
+        return nullptr;
+    }
+  }
+
+  [[nodiscard]] auto in_layer() const noexcept -> bool {
+    if (stack_.empty()) return false;
+    const auto kind = stack_.back().kind;
+    return kind == Kind::tiles || kind == Kind::explored || kind == Kind::visible;
+  }
+
+  template <typename T>
+  auto add(T&& value) -> bool {
+    if (stack_.empty()) throw std::runtime_error("The save is not a JSON object.");
+    if (in_layer()) {
+      if constexpr (std::is_arithmetic_v<std::decay_t<T>>) {
+        switch (stack_.back().kind) {
+          case Kind::tiles:
+            tiles_.emplace_back(static_cast<Tiles>(value));
+            break;
+          case Kind::explored:
+            explored_.emplace_back(static_cast<bool>(value));
+            break;
+          default:
+            visible_.emplace_back(static_cast<bool>(value));
+            break;
+        }
+        return true;
+      }
+      throw std::runtime_error("Map layers must only hold numbers.");
+    }
+    auto kind = Kind::skip;
+    if (place(json(std::forward<T>(value)), kind) == &fragment_) finish_fragment();
+    return true;
+  }
+
+  auto start(json&& container) -> bool {
+    if (in_layer()) throw std::runtime_error("Map layers must only hold numbers.");
+    auto kind = Kind::skip;
+    auto* placed = place(std::move(container), kind);
+    stack_.push_back({kind, placed, {}});
+    return true;
+  }
+
+  auto end() -> bool {
+    const bool is_fragment = stack_.back().value && stack_.back().value == &fragment_;
+    stack_.pop_back();
+    if (is_fragment) finish_fragment();
+    return true;
+  }
+
+  void finish_fragment() {
+    if (fragment_kind_ == Kind::actors) {
+      const auto actor_id = fragment_.at(0).get<ActorID>();
+      auto& actor = world_.actors[actor_id];
+      fragment_.at(1).get_to(actor);
+      actor.id = actor_id;
+    } else {
+      const auto map_id = legacy_maps_ ? MapID{"caves", 0} : fragment_.at(0).get<MapID>();
+      const auto& j = legacy_maps_ ? fragment_ : fragment_.at(1);
+      auto& map = world_.maps[map_id];
+      map.tiles = take_layer(j.at("tiles"), tiles_);
+      map.explored = take_layer(j.at("explored"), explored_);
+      map.visible = take_layer(j.at("visible"), visible_);
+      map_fields_from_json(j, map);
+    }
+    fragment_ = nullptr;
+  }
+
+  /// Return the layer with the shape given in `j` and the values in `values`, leaving `values` empty.
+  template <typename T>
+  static auto take_layer(const json& j, std::vector<T>& values) -> util::Array2D<T> {
+    auto array = util::Array2D<T>{j.at("shape").get<std::array<int, 2>>()};
+    if (array.get_container().size() != values.size()) {
+      throw std::runtime_error("A map layer does not match its shape.");
+    }
+    array.get_container().swap(values);
+    values.clear();
+    return array;
+  }
+
+  World& world_;
+  std::vector<Frame> stack_;  // The containers being parsed, outermost first.
+  bool found_world_ = false;
+  bool legacy_maps_ = false;
+  json rest_ = json::object();  // World fields other than actors and maps.
+  json fragment_;  // The actor or map being built.
+  Kind fragment_kind_ = Kind::skip;  // Kind::actors or Kind::maps for `fragment_`.
+  std::vector<Tiles> tiles_;  // Layers of the map being built.
+  std::vector<bool> explored_;
+  std::vector<bool> visible_;
+};
+
+/// Load a World from the JSON save in `input`, streaming it instead of parsing the whole document first.
+inline auto load_world_json(std::istream& input) -> std::unique_ptr<World> {
+  auto world = std::make_unique<World>();
+  auto reader = JsonWorldReader{*world};
+  json::sax_parse(input, &reader);
+  reader.finish();
+  return world;
+}
+
+/// Return true if `path` is saved as JSON instead of the binary format.  JSON is kept for importing and exporting.
+inline auto is_json_path(const std::filesystem::path& path) -> bool { return path.extension() == ".json"; }
+
+/// Save `world` to `path`, in the binary format unless the path ends with ".json".
+inline auto save_world(const World& world, std::filesystem::path path, jobs::Scheduler* scheduler = nullptr) -> void {
+  const trace::Zone trace_zone{"save_world"};
+  const memstats::Scope memory_scope{memstats::Subsystem::serialization};
+  if (is_json_path(path)) {
+    json data{};
+    data["world"] = world_to_json(world, scheduler);
+    std::ofstream f{path};
+    f << data << "\n";
+  } else {
+    const auto data = binary::encode_world(world, scheduler);
+    std::ofstream f{path, std::ios::binary};
+    f.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+  }
   std::cout << "Game saved.\n";
-#ifdef __EMSCRIPTEN__
-  // clang-format off
-  EM_ASM(
-    FS.syncfs(false, function (err) {
-      assert(!err);
-      console.log("SyncFS finished.");
-    });
-  );
-  // clang-format on
-#endif
+  save::sync_filesystem();
 }
 
 inline auto load_world(std::filesystem::path path) -> std::unique_ptr<World> {
+  const trace::Zone trace_zone{"load_world"};
+  const memstats::Scope memory_scope{memstats::Subsystem::serialization};
   if (!std::filesystem::exists(path)) {
     std::cerr << "Save file does not exist:\n" << path << "\n";
     return nullptr;
   }
   try {
-    std::fstream f{path};
-    json data = json::parse(f);
-    std::unique_ptr<World> world = std::make_unique<World>();
-    data.at("world").get_to(*world);
-    return world;
+    if (!is_json_path(path)) {
+      std::ifstream f{path, std::ios::binary};
+      const auto data = std::vector<char>{std::istreambuf_iterator<char>{f}, std::istreambuf_iterator<char>{}};
+      return binary::decode_world(std::as_bytes(std::span{data}));
+    }
+    std::ifstream f{path};
+    return load_world_json(f);
   } catch (const std::exception& exc) {
     std::cerr << "Failed to load world:\n" << exc.what() << "\n";
   }
   return nullptr;
 }
 
-inline auto save_world(const World& world) -> void {
-  std::filesystem::create_directories("saves");
-  return save_world(world, "saves/save.json");
+/// Delete the default save, including any save from before incremental saves.
+inline auto delete_save() -> void {
+  std::filesystem::remove_all(save::DEFAULT_DIRECTORY);
+  std::filesystem::remove("saves/save.bin");
+  std::filesystem::remove("saves/save.json");
 }
 
-inline auto load_world() -> std::unique_ptr<World> { return load_world("saves/save.json"); }
+/// Load the default save.  Single file saves from older versions are imported if there is no incremental save.
+inline auto load_world() -> std::unique_ptr<World> {
+  if (std::filesystem::exists(save::DEFAULT_DIRECTORY / save::MANIFEST_NAME)) {
+    try {
+      return save::load_incremental(save::DEFAULT_DIRECTORY);
+    } catch (const std::exception& exc) {
+      std::cerr << "Failed to load world:\n" << exc.what() << "\n";
+      return nullptr;
+    }
+  }
+  if (!std::filesystem::exists("saves/save.bin") && std::filesystem::exists("saves/save.json")) {
+    return load_world("saves/save.json");
+  }
+  return load_world("saves/save.bin");
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <chrono>
+#include <future>
+
+#include "fov.hpp"
+#include "globals.hpp"
+#include "memory_stats.hpp"
+#include "perf_stats.hpp"
+#include "world_logic.hpp"
+
+/// Run everything which happens after the player has acted.
+inline void advance_turn(GameContext& context) {
+  const perfstats::Scope perf_scope{context.perf_stats};  // The turn may run on its own thread.
+  {
+    const perfstats::Timer timer{perfstats::Metric::turn};
+    auto& world = *context.world;
+    update_fov(world.active_map(), world.active_player().pos);
+    enemy_turn(context);
+    if (context.map_export) context.map_export->publish(world);
+  }
+  context.turn_arena.reset();  // Nothing allocated during the turn outlives it.
+  memstats::end_window(memstats::Window::turn);
+  perfstats::end_window(perfstats::Window::turn);
+}
+
+/// Simulate the rest of the turn after the player has acted, then publish what should be drawn.
+inline void simulate_turn(GameContext& context) {
+  advance_turn(context);
+  context.snapshots.publish(*context.world);
+}
+
+/// Begin simulating the rest of the turn.
+/// Runs on its own thread where available, the World must not be touched until `finish_turn` is called.
+/// Without threads the turn is simulated before returning, but is still finished through `finish_turn`.
+inline void start_turn(GameContext& context) {
+  assert(!context.pending_turn.valid());
+#ifdef __EMSCRIPTEN__
+  auto turn = std::packaged_task<void()>{[&context]() { simulate_turn(context); }};  // Not built with threads.
+  context.pending_turn = turn.get_future();
+  turn();
+#else
+  context.pending_turn = std::async(std::launch::async, [&context]() { simulate_turn(context); });
+#endif
+}
+
+/// Return true if a turn started by `start_turn` is still being simulated.
+[[nodiscard]] inline auto is_turn_running(const GameContext& context) -> bool {
+  return context.pending_turn.valid() &&
+         context.pending_turn.wait_for(std::chrono::seconds{0}) != std::future_status::ready;
+}
+
+/// Wait for the turn started by `start_turn` to finish, rethrowing any errors from it.
+/// Returns false if no turn was started.
+inline auto finish_turn(GameContext& context) -> bool {
+  if (!context.pending_turn.valid()) return false;
+  context.pending_turn.get();
+  return true;
+}
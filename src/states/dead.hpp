@@ -1,8 +1,9 @@
 #pragma once
 #include <cassert>
-#include <filesystem>
 
 #include "../rendering.hpp"
+#include "../replay.hpp"
+#include "../serialization.hpp"
 #include "../types/state.hpp"
 #include "main_menu.hpp"
 
@@ -14,7 +15,9 @@ class Dead : public State {
       case SDL_EVENT_KEY_DOWN:
         switch (event.key.key) {
           case SDLK_ESCAPE:
-            std::filesystem::remove("saves/save.json");
+            replay::end_recording(context);
+            context.saves.wait();
+            delete_save();
             context.world = nullptr;
             return Change{std::make_unique<MainMenu>()};
           default:
@@ -22,7 +25,10 @@ class Dead : public State {
         }
         break;
       case SDL_EVENT_QUIT:
-        std::filesystem::remove("saves/save.json");
+        replay::end_recording(context);
+        context.saves.wait();
+        delete_save();
+        context.world = nullptr;  // Not saved again when quitting.
         return Quit{};
       default:
         break;
@@ -10,8 +10,11 @@
 #include "../globals.hpp"
 #include "../input_tools.hpp"
 #include "../procgen/caves.hpp"
+#include "../recording.hpp"
 #include "../rendering.hpp"
+#include "../replay.hpp"
 #include "../serialization.hpp"
+#include "../trace.hpp"
 #include "../types/state.hpp"
 #include "main_menu.hpp"
 #include "pick_inventory.hpp"
@@ -31,25 +34,41 @@ class InGame : public State {
       case SDL_EVENT_KEY_DOWN: {
         switch (event.key.key) {
           case SDLK_G:
-            return do_action(context, action::Pickup{});
+            return do_action(context, replay::Pickup{});
           case SDLK_I:
             return Change{std::make_unique<PickInventory>(
                 std::move(context.state),
-                [](GameContext& ctx, int item_index) { return do_action(ctx, action::UseItem{item_index}); })};
+                [](GameContext& ctx, int item_index) { return do_action(ctx, replay::UseItem{item_index}); })};
           case SDLK_COMMA:
-            if (event.key.mod & SDL_KMOD_SHIFT) return do_action(context, action::UseStairs(false));
+            if (event.key.mod & SDL_KMOD_SHIFT) return do_action(context, replay::UseStairs{false});
             break;
           case SDLK_PERIOD:
-            if (event.key.mod & SDL_KMOD_SHIFT) return do_action(context, action::UseStairs(true));
+            if (event.key.mod & SDL_KMOD_SHIFT) return do_action(context, replay::UseStairs{true});
             break;
           case SDLK_F2:
-            procgen::generate_level(world);
+            replay::record(context, replay::RegenerateLevel{});
+            procgen::generate_level(world, 1, context.level_params, context.simulate_frozen_levels, &context.scheduler);
             return {};
           case SDLK_F3:
+            replay::record(context, replay::RevealMap{});
             for (auto&& it : world.active_map().explored) it = true;
+            world.active_map().dirty = true;
+            return {};
+          case SDLK_F4:
+            context.show_memory_stats = !context.show_memory_stats;
+            return {};
+          case SDLK_F5:
+            if (!context.trace_path.empty()) {
+              const auto count = trace::write_chrome_trace(context.trace_path);
+              fmt::print("Wrote {} trace zones to {}\n", count, context.trace_path.string());
+            }
+            return {};
+          case SDLK_F6:
+            context.show_perf_stats = !context.show_perf_stats;
             return {};
           case SDLK_ESCAPE:
-            save_world(world);
+            replay::end_recording(context);
+            save::save_in_background(context.saves, world, &context.scheduler);
             return Change{std::make_unique<MainMenu>()};
           default:
             break;
@@ -75,17 +94,14 @@ class InGame : public State {
 
  private:
   static auto cmd_move(GameContext& context, Position dir) -> StateReturnType {
-    return do_action(context, action::Bump{dir});
-  }
-
-  static auto do_action(GameContext& context, action::Action& my_action) -> StateReturnType {
-    auto& world = *context.world;
-    return after_action(context, my_action.perform(context, world.active_player()));
+    return do_action(context, replay::Bump{dir});
   }
 
-  static auto do_action(GameContext& context, action::Action&& my_action) -> StateReturnType {
+  /// Record and perform a player command.
+  static auto do_action(GameContext& context, const replay::Command& command) -> StateReturnType {
     auto& world = *context.world;
-    return after_action(context, my_action.perform(context, world.active_player()));
+    replay::record(context, command);
+    return after_action(context, replay::to_action(command)->perform(context, world.active_player()));
   }
 
   static auto after_action(GameContext& context, action::Result result) -> StateReturnType {
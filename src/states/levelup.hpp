@@ -2,6 +2,7 @@
 #include <fmt/core.h>
 
 #include "../globals.hpp"
+#include "../recording.hpp"
 #include "../xp.hpp"
 #include "menu.hpp"
 
@@ -12,21 +13,9 @@ class LevelUp : public Menu {
       : Menu{
             MenuItems{
                 {"Constitution (+20HP)",
-                 [](GameContext& ctx) {
-                   ctx.world->active_player().stats.hp += 20;
-                   ctx.world->active_player().stats.max_hp += 20;
-                   return level_up_done(ctx);
-                 }},
-                {"Strength (+1 attack)",
-                 [](GameContext& ctx) {
-                   ctx.world->active_player().stats.attack += 1;
-                   return level_up_done(ctx);
-                 }},
-                {"Agility (+1 defense)",
-                 [](GameContext& ctx) {
-                   ctx.world->active_player().stats.defense += 1;
-                   return level_up_done(ctx);
-                 }}},
+                 [](GameContext& ctx) { return level_up_done(ctx, LevelUpStat::constitution); }},
+                {"Strength (+1 attack)", [](GameContext& ctx) { return level_up_done(ctx, LevelUpStat::strength); }},
+                {"Agility (+1 defense)", [](GameContext& ctx) { return level_up_done(ctx, LevelUpStat::agility); }}},
             selected} {
     assert(context.world);
     context.world->log.append(
@@ -35,10 +24,9 @@ class LevelUp : public Menu {
   }
 
  private:
-  static auto level_up_done(GameContext& ctx) -> StateReturnType {
-    auto& player = ctx.world->active_player();
-    player.stats.xp -= next_level_xp(player.stats.level);
-    ++player.stats.level;
+  static auto level_up_done(GameContext& ctx, LevelUpStat stat) -> StateReturnType {
+    replay::record(ctx, replay::LevelUp{stat});
+    level_up(ctx.world->active_player().stats, stat);
     return Reset{};
   }
 };
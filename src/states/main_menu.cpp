@@ -5,6 +5,7 @@
 #include <memory>
 
 #include "../globals.hpp"
+#include "../replay.hpp"
 #include "../serialization.hpp"
 #include "../world_init.hpp"
 #include "ingame.hpp"
@@ -15,15 +16,18 @@ MainMenu::MainMenu(int selected)
           MenuItems{
               {"[N] New Game",
                [](GameContext& context) -> state::Result {
-                 context.world = new_world();
+                 context.world = new_world(std::random_device{}(), context.level_params, &context.scheduler);
+                 replay::begin_recording(context);
                  return state::Change{std::make_unique<state::InGame>()};
                },
                SDLK_N},  // SDL3: uppercase key codes
               {"[C] Continue",
                [](GameContext& context) -> state::Result {
+                 context.saves.wait();
                  std::unique_ptr<World> loaded = load_world();
                  if (loaded) {
                    context.world = std::move(loaded);
+                   replay::begin_recording(context);
                    return state::Change{std::make_unique<state::InGame>()};
                  }
                  return {};
@@ -54,12 +54,11 @@ class PickInventory : public State {
         "[a-z]Use Item, [ESC]Cancel",
         tcod::ColorRGB{0, 0, 0},
         tcod::ColorRGB{255, 255, 255});
-    if (context.world->active_player().stats.inventory.size()) {
+    if (const auto snapshot = context.snapshots.get(); snapshot && snapshot->inventory.size()) {
       int shortcut = 'a';
       int y = 1;
-      for (const auto& item : context.world->active_player().stats.inventory) {
-        tcod::print(
-            console, {1, y++}, fmt::format("({:c}) {} ({})", shortcut++, item->get_name(), item->count), {}, {});
+      for (const auto& [item_name, item_count] : snapshot->inventory) {
+        tcod::print(console, {1, y++}, fmt::format("({:c}) {} ({})", shortcut++, item_name, item_count), {}, {});
       }
     } else {
       tcod::print(console, {1, 1}, "You have no items.", {}, {});
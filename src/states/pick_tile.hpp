@@ -3,6 +3,7 @@
 
 #include "../globals.hpp"
 #include "../input_tools.hpp"
+#include "../recording.hpp"
 #include "../rendering.hpp"
 #include "../types/state.hpp"
 
@@ -60,10 +61,16 @@ class PickTile : public State {
 
   auto on_draw(GameContext& context) -> void override { render_all(context); }
 
+  /// Pick `target`, this is recorded as a player command.
+  auto pick(GameContext& context, Position target) -> StateReturnType {
+    replay::record(context, replay::PickTile{target});
+    return on_pick_(context, target);
+  }
+
  private:
   auto on_pick(GameContext& context) -> StateReturnType {
     if (!context.controller.cursor) return Change{std::move(parent_)};
-    return on_pick_(context, *context.controller.cursor);
+    return pick(context, *context.controller.cursor);
   }
   std::unique_ptr<State> parent_;
   PickFunction on_pick_;
@@ -14,9 +14,9 @@ class PickTileAreaOfEffect : public PickTile {
 
   auto on_draw(GameContext& context) -> void override {
     render_all(context);
-    if (!context.controller.cursor) return;
-    const auto& map = context.world->active_map();
-    with_indexes(map, [this, &context, pos = *context.controller.cursor](int x, int y) {
+    const auto snapshot = context.snapshots.get();
+    if (!context.controller.cursor || !snapshot) return;
+    with_indexes(snapshot->tiles, [this, &context, pos = *context.controller.cursor](int x, int y) {
       if (euclidean_squared(Position{x, y} - pos) >= radius_squared_) return;
       if (!context.console.in_bounds({x, y})) return;
       auto& tile = context.console.at({x, y});
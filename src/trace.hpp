@@ -0,0 +1,178 @@
+#pragma once
+#include <fmt/os.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*****************************************************************************
+    Scoped trace zones, written out as Chrome trace-event JSON for chrome://tracing or https://ui.perfetto.dev.
+
+    A Zone records when it was constructed and destroyed.  Tracing is off until `enable` is called, until then a Zone
+    costs one relaxed atomic load.  Finished zones go into a ring buffer owned by the recording thread, which only that
+    thread writes to, so recording never locks or allocates.  Each ring keeps the last RING_SIZE zones of its thread.
+
+    `write_chrome_trace` copies every ring while threads keep recording and skips any zone overwritten during the copy.
+    Rings are reused by new threads once their thread exits, so threads started for each turn do not each keep a ring.
+    Zone names must be string literals, they are stored as pointers and written without escaping.
+ */
+namespace trace {
+namespace detail {
+inline constexpr size_t RING_SIZE = size_t{1} << 15;  // Zones kept per thread.
+
+[[nodiscard]] inline auto now() noexcept -> int64_t {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+/// One finished zone.  Fields are atomic so that they can be copied while the owning thread overwrites them.
+struct Slot {
+  std::atomic<const char*> name = nullptr;
+  std::atomic<int64_t> start = 0;  // Nanoseconds since the epoch of `now`.
+  std::atomic<int64_t> duration = 0;
+};
+
+/// The zones recorded by one thread at a time.
+struct Ring {
+  explicit Ring(int id) : id{id} {}
+  const int id;  // Shown as the thread ID.
+  std::atomic<uint64_t> head = 0;  // How many zones were ever recorded, the next one goes in slots[head % RING_SIZE].
+  std::array<Slot, RING_SIZE> slots;
+
+  void record(const char* name, int64_t start, int64_t duration) noexcept {
+    const auto index = head.load(std::memory_order_relaxed);
+    auto& slot = slots[index % RING_SIZE];
+    std::atomic_thread_fence(std::memory_order_release);  // A reader which sees these stores also sees head >= index.
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(duration, std::memory_order_relaxed);
+    head.store(index + 1, std::memory_order_release);
+  }
+};
+
+/// Every ring, and those whose thread has exited.
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Ring>> rings;
+  std::vector<Ring*> free;
+};
+inline auto get_registry() -> Registry& {
+  static auto registry = Registry{};
+  return registry;
+}
+
+/// Holds a ring for the lifetime of a thread, then returns it to the registry for the next thread.
+class Lease {
+ public:
+  Lease() {
+    auto& registry = get_registry();
+    auto lock = std::lock_guard{registry.mutex};
+    if (!registry.free.empty()) {
+      ring_ = registry.free.back();
+      registry.free.pop_back();
+    } else {
+      ring_ = registry.rings.emplace_back(std::make_unique<Ring>(static_cast<int>(registry.rings.size()))).get();
+    }
+  }
+  Lease(const Lease&) = delete;
+  Lease& operator=(const Lease&) = delete;
+  ~Lease() {
+    auto& registry = get_registry();
+    auto lock = std::lock_guard{registry.mutex};
+    registry.free.emplace_back(ring_);
+  }
+  [[nodiscard]] auto get() const noexcept -> Ring& { return *ring_; }
+
+ private:
+  Ring* ring_;
+};
+
+inline std::atomic<bool> enabled = false;
+
+inline void record(const char* name, int64_t start, int64_t duration) {
+  thread_local const auto lease = Lease{};
+  lease.get().record(name, start, duration);
+}
+}  // namespace detail
+
+/// Start recording zones.
+inline void enable() noexcept { detail::enabled.store(true, std::memory_order_relaxed); }
+[[nodiscard]] inline auto is_enabled() noexcept -> bool { return detail::enabled.load(std::memory_order_relaxed); }
+
+/// Records the time from construction to destruction as a zone named `name` on the current thread.
+class Zone {
+ public:
+  explicit Zone(const char* name) noexcept : name_{name}, start_{is_enabled() ? detail::now() : -1} {}
+  Zone(const Zone&) = delete;
+  Zone& operator=(const Zone&) = delete;
+  ~Zone() {
+    if (start_ >= 0) detail::record(name_, start_, detail::now() - start_);
+  }
+
+ private:
+  const char* name_;
+  int64_t start_;  // -1 if tracing was off when this zone started.
+};
+
+/// Write every recorded zone to `path` as Chrome trace-event JSON and return how many were written.
+/// Safe to call while other threads record zones.
+inline auto write_chrome_trace(const std::filesystem::path& path) -> size_t {
+  auto& registry = detail::get_registry();
+  auto rings = std::vector<detail::Ring*>{};
+  {
+    auto lock = std::lock_guard{registry.mutex};
+    for (const auto& ring : registry.rings) rings.emplace_back(ring.get());
+  }
+  struct Event {
+    const char* name;
+    int64_t start;
+    int64_t duration;
+  };
+  auto events = std::vector<Event>{};
+  auto out = fmt::output_file(path.string());
+  out.print("{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  const char* separator = "\n";
+  size_t count = 0;
+  for (const auto* ring : rings) {
+    out.print(
+        "{}{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"thread {}\"}}}}",
+        separator,
+        ring->id,
+        ring->id);
+    separator = ",\n";
+    const auto head = ring->head.load(std::memory_order_acquire);
+    const auto first = head > detail::RING_SIZE ? head - detail::RING_SIZE : 0;
+    events.clear();
+    for (auto i = first; i < head; ++i) {
+      const auto& slot = ring->slots[i % detail::RING_SIZE];
+      events.push_back(
+          {slot.name.load(std::memory_order_relaxed),
+           slot.start.load(std::memory_order_relaxed),
+           slot.duration.load(std::memory_order_relaxed)});
+    }
+    // Zones recorded during the copy may have overwritten the oldest slots, including one still being written.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const auto head_after = ring->head.load(std::memory_order_relaxed);
+    const auto valid = head_after >= detail::RING_SIZE ? head_after - detail::RING_SIZE + 1 : 0;
+    for (auto i = std::max(first, valid); i < head; ++i) {
+      const auto& event = events[i - first];
+      out.print(
+          ",\n{{\"ph\":\"X\",\"name\":\"{}\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+          event.name,
+          ring->id,
+          static_cast<double>(event.start) / 1000.0,
+          static_cast<double>(event.duration) / 1000.0);
+      ++count;
+    }
+  }
+  out.print("\n]}}\n");
+  return count;
+}
+}  // namespace trace
@@ -0,0 +1,127 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+#include "jobs.hpp"
+
+/*****************************************************************************
+    Arenas for allocations which only last until the end of a turn.
+
+    Pathfinding grids, noise fields, target lists and the like are allocated from the calling thread's arena with a
+    std::pmr::polymorphic_allocator and never freed individually.  The whole arena is released at once when the turn
+    ends.  Each arena reuses one buffer, and a turn which outgrows it takes the rest from the heap and grows the buffer
+    to fit on the next reset, so a steady game stops allocating from the heap for these altogether.
+
+    Anything allocated from an arena must be gone by the end of the turn.  Copy results into normal containers to keep
+    them, moving a container keeps its allocator.
+ */
+namespace arena {
+/// A monotonic memory resource over a reusable buffer.  Only one thread may use it at a time.
+class Arena : public std::pmr::memory_resource {
+ public:
+  explicit Arena(size_t capacity = 64 * 1024) : buffer_(capacity) {
+    resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+  }
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /// Free everything allocated from this arena, growing its buffer if the last use did not fit.
+  void reset() {
+    resource_->release();
+    last_overflow_bytes_ = overflow_.bytes;
+    if (overflow_.bytes) {
+      buffer_ = std::vector<std::byte>(std::bit_ceil(buffer_.size() + overflow_.bytes));
+      resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+    }
+    overflow_.bytes = 0;
+    allocation_count_ = 0;
+    allocated_bytes_ = 0;
+  }
+
+  /// Return the number of allocations since the last reset.
+  [[nodiscard]] auto get_allocation_count() const noexcept -> size_t { return allocation_count_; }
+  /// Return the bytes allocated since the last reset.
+  [[nodiscard]] auto get_allocated_bytes() const noexcept -> size_t { return allocated_bytes_; }
+  [[nodiscard]] auto get_capacity() const noexcept -> size_t { return buffer_.size(); }
+  /// Return the bytes which did not fit in the buffer before the last reset, and were taken from the heap instead.
+  [[nodiscard]] auto get_last_overflow_bytes() const noexcept -> size_t { return last_overflow_bytes_; }
+
+ private:
+  /// Takes what does not fit in the buffer from the heap, counting it so the buffer can grow.
+  struct Overflow : public std::pmr::memory_resource {
+    size_t bytes = 0;
+    auto do_allocate(size_t size, size_t alignment) -> void* override {
+      bytes += size;
+      return std::pmr::new_delete_resource()->allocate(size, alignment);
+    }
+    void do_deallocate(void* p, size_t size, size_t alignment) override {
+      std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+    }
+    [[nodiscard]] auto do_is_equal(const memory_resource& other) const noexcept -> bool override {
+      return this == &other;
+    }
+  };
+
+  auto do_allocate(size_t size, size_t alignment) -> void* override {
+    ++allocation_count_;
+    allocated_bytes_ += size;
+    return resource_->allocate(size, alignment);
+  }
+  void do_deallocate(void*, size_t, size_t) override {}  // Freed all at once by `reset`.
+  [[nodiscard]] auto do_is_equal(const memory_resource& other) const noexcept -> bool override {
+    return this == &other;
+  }
+
+  std::vector<std::byte> buffer_;
+  Overflow overflow_;
+  std::optional<std::pmr::monotonic_buffer_resource> resource_;  // Allocates from buffer_, then overflow_.
+  size_t allocation_count_ = 0;
+  size_t allocated_bytes_ = 0;
+  size_t last_overflow_bytes_ = 0;
+};
+
+/// One Arena for each thread of a scheduler, reset together at the end of each turn.
+class TurnArena {
+ public:
+  explicit TurnArena(const jobs::Scheduler& scheduler) : scheduler_{scheduler} {
+    arenas_.emplace_back(std::make_unique<Arena>());
+  }
+
+  /// Return the arena of the calling thread, which must be the thread running the turn or a worker of the scheduler.
+  /// Workers started since the last reset have no arena yet and allocate from the heap instead.
+  [[nodiscard]] auto local() -> std::pmr::memory_resource& {
+    const auto index = scheduler_.get_thread_index();
+    if (index >= arenas_.size()) return *std::pmr::new_delete_resource();
+    return *arenas_[index];
+  }
+
+  /// Free everything allocated this turn.  Must not be called while any thread is using the arenas.
+  void reset() {
+    for (auto& arena : arenas_) arena->reset();
+    while (arenas_.size() < scheduler_.get_worker_count() + 1) arenas_.emplace_back(std::make_unique<Arena>());
+  }
+
+  /// Return the number of allocations from every arena since the last reset.
+  [[nodiscard]] auto get_allocation_count() const noexcept -> size_t {
+    size_t count = 0;
+    for (const auto& arena : arenas_) count += arena->get_allocation_count();
+    return count;
+  }
+
+  /// Return the bytes which did not fit in the arenas during the last turn.  Zero once the arenas fit a steady game.
+  [[nodiscard]] auto get_last_overflow_bytes() const noexcept -> size_t {
+    size_t bytes = 0;
+    for (const auto& arena : arenas_) bytes += arena->get_last_overflow_bytes();
+    return bytes;
+  }
+
+ private:
+  const jobs::Scheduler& scheduler_;
+  std::vector<std::unique_ptr<Arena>> arenas_;  // Indexed by jobs::Scheduler::get_thread_index.
+};
+}  // namespace arena
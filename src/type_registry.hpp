@@ -0,0 +1,148 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+
+#include "binary_io.hpp"
+#include "json.hpp"
+#include "types/action.hpp"
+#include "types/item.hpp"
+
+/*****************************************************************************
+    Registries of the polymorphic types which are saved, items and AI.
+
+    Each type registers itself next to its definition with a name stored by JSON saves and a tag stored by binary
+    saves, neither of which may change once saves exist.  Tag 0 is reserved for a missing object.  A registered type
+    must be default constructible and describe its saved fields with a static `visit_fields(self, visit)` which calls
+    `visit(name, self.field)` for each field, in the order binary saves store them:
+
+        template <typename Self, typename Visitor>
+        static void visit_fields(Self& self, Visitor&& visit) {
+          visit("count", self.count);
+        }
+        inline const bool HEALTH_POTION_REGISTERED = get_item_types().add<HealthPotion>("HealthPotion", 1);
+
+    Encoding an object finds its type with one hash lookup of its typeid, decoding finds it by name or tag.  Unknown
+    names and tags throw, so a damaged or newer save fails to load instead of crashing.
+ */
+template <typename Base>
+class TypeRegistry {
+ public:
+  /// How to save one registered type.
+  struct Entry {
+    std::string name;
+    uint8_t tag = 0;
+    bool has_fields = false;  // JSON only stores "data" for types with fields.
+    auto (*construct)() -> std::unique_ptr<Base> = nullptr;
+    void (*to_json)(json& j, const Base& object) = nullptr;
+    void (*from_json)(const json& j, Base& object) = nullptr;
+    void (*write)(binary::Writer& out, const Base& object) = nullptr;
+    void (*read)(binary::Reader& in, Base& object) = nullptr;
+  };
+
+  /// Register `T` as `name` and `tag`.  Returns true so that it can initialize a static variable.
+  template <typename T>
+  auto add(std::string name, uint8_t tag) -> bool {
+    static_assert(std::is_base_of_v<Base, T>);
+    if (tag == 0) throw std::logic_error("Type tag 0 is reserved: " + name);
+    if (by_tag_[tag] || by_name_.contains(name)) throw std::logic_error("Type is already registered: " + name);
+    auto entry = std::make_unique<Entry>();
+    entry->name = std::move(name);
+    entry->tag = tag;
+    const auto probe = T{};
+    T::visit_fields(probe, [&entry](const char*, const auto&) { entry->has_fields = true; });
+    entry->construct = []() -> std::unique_ptr<Base> { return std::make_unique<T>(); };
+    entry->to_json = [](json& j, const Base& object) {
+      T::visit_fields(static_cast<const T&>(object), [&j](const char* field, const auto& value) { j[field] = value; });
+    };
+    entry->from_json = [](const json& j, Base& object) {
+      T::visit_fields(static_cast<T&>(object), [&j](const char* field, auto& value) { j.at(field).get_to(value); });
+    };
+    entry->write = [](binary::Writer& out, const Base& object) {
+      T::visit_fields(static_cast<const T&>(object), [&out](const char*, const auto& value) {
+        static_assert(std::is_integral_v<std::remove_cvref_t<decltype(value)>>, "Only integer fields are supported.");
+        out.write_signed(value);
+      });
+    };
+    entry->read = [](binary::Reader& in, Base& object) {
+      T::visit_fields(static_cast<T&>(object), [&in](const char*, auto& value) { value = in.read_int(); });
+    };
+    by_type_.emplace(typeid(T), entry.get());
+    by_name_.emplace(entry->name, entry.get());
+    by_tag_[tag] = std::move(entry);
+    return true;
+  }
+
+  /// Return the entry for the dynamic type of `object`.  Throws std::logic_error if it was never registered.
+  [[nodiscard]] auto find(const Base& object) const -> const Entry& {
+    const auto it = by_type_.find(typeid(object));
+    if (it == by_type_.end()) throw std::logic_error(std::string{"Type can not be saved: "} + typeid(object).name());
+    return *it->second;
+  }
+  /// Return the entry registered as `name`.  Throws std::runtime_error if there is none.
+  [[nodiscard]] auto find(std::string_view name) const -> const Entry& {
+    const auto it = by_name_.find(std::string{name});
+    if (it == by_name_.end()) throw std::runtime_error("Unknown type: " + std::string{name});
+    return *it->second;
+  }
+  /// Return the entry registered as `tag`.  Throws binary::DecodeError if there is none.
+  [[nodiscard]] auto find(uint8_t tag) const -> const Entry& {
+    if (!by_tag_[tag]) throw binary::DecodeError("Unknown type tag: " + std::to_string(tag));
+    return *by_tag_[tag];
+  }
+
+  /// Encode `object` as {"type": name, "data": fields}, "data" is left out if the type has no fields.
+  void to_json(json& j, const Base& object) const {
+    const auto& entry = find(object);
+    j["type"] = entry.name;
+    if (entry.has_fields) entry.to_json(j["data"], object);
+  }
+  [[nodiscard]] auto from_json(const json& j) const -> std::unique_ptr<Base> {
+    const auto& entry = find(j.at("type").template get_ref<const std::string&>());
+    auto object = entry.construct();
+    if (entry.has_fields) entry.from_json(j.at("data"), *object);
+    return object;
+  }
+
+  /// Write `object` as its tag followed by its fields.
+  void write(binary::Writer& out, const Base& object) const {
+    const auto& entry = find(object);
+    out.write_byte(entry.tag);
+    entry.write(out, object);
+  }
+  /// Read an object written by `write`.
+  [[nodiscard]] auto read(binary::Reader& in) const -> std::unique_ptr<Base> { return read(in, in.read_byte()); }
+  /// Read the fields of an object whose `tag` was already read.
+  [[nodiscard]] auto read(binary::Reader& in, uint8_t tag) const -> std::unique_ptr<Base> {
+    const auto& entry = find(tag);
+    auto object = entry.construct();
+    entry.read(in, *object);
+    return object;
+  }
+
+ private:
+  std::unordered_map<std::type_index, const Entry*> by_type_;
+  std::unordered_map<std::string, const Entry*> by_name_;
+  std::array<std::unique_ptr<Entry>, 256> by_tag_;
+};
+
+/// The registry of every Item type which can be saved.
+[[nodiscard]] inline auto get_item_types() -> TypeRegistry<Item>& {
+  static auto registry = TypeRegistry<Item>{};
+  return registry;
+}
+
+namespace action {
+/// The registry of every AI type which can be saved.
+[[nodiscard]] inline auto get_ai_types() -> TypeRegistry<Action>& {
+  static auto registry = TypeRegistry<Action>{};
+  return registry;
+}
+}  // namespace action
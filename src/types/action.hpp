@@ -1,6 +1,9 @@
 #pragma once
+#include <memory_resource>
+
 #include "action_result.hpp"
 #include "actor_fwd.hpp"
+#include "world_fwd.hpp"
 
 struct GameContext;
 
@@ -8,6 +11,10 @@ namespace action {
 class Action {
  public:
   virtual ~Action() = default;
+  /// Optionally prepare this action ahead of `perform`.  This may only read the world, since the scheduled actors
+  /// are planned in parallel before any of them perform.  Scratch space may be allocated from `arena`, the calling
+  /// thread's per-turn arena.
+  virtual void plan(const World&, const Actor&, std::pmr::memory_resource& /*arena*/) {}
   [[nodiscard]] virtual Result perform(GameContext& context, Actor& actor) = 0;
 };
 }  // namespace action
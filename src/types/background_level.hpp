@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../jobs.hpp"
+#include "actor.hpp"
+#include "actor_id.hpp"
+#include "map.hpp"
+#include "position.hpp"
+
+/// Everything a frozen level needs to keep running on its own.  This is owned by its task while simulating.
+struct BackgroundLevelState {
+  util::Array2D<Tiles> tiles;  // A private copy of the map tiles.
+  std::vector<std::unordered_map<ActorID, Actor>::node_type> actors;  // Actors extracted from World::actors.
+  std::unordered_set<Position> occupied;
+  std::unordered_set<Position> reserved;  // Tiles nothing wanders onto, such as the stairs the player arrives at.
+  std::mt19937 rng;  // An RNG stream separate from World::rng.
+  int steps = 0;  // The number of coarse steps simulated so far.
+};
+
+/// A frozen level which keeps being simulated as tasks on a jobs::Scheduler.
+/// The main thread only ever signals the step to simulate up to, it never touches the state until `stop` is called.
+/// Without a scheduler the steps run immediately on the calling thread.
+class BackgroundLevel {
+ public:
+  using StepFunction = std::function<void(BackgroundLevelState&)>;
+
+  BackgroundLevel(BackgroundLevelState state, int start_turn, StepFunction step, jobs::Scheduler* scheduler)
+      : state_{std::move(state)}, start_turn_{start_turn}, step_{std::move(step)}, scheduler_{scheduler} {
+    for (const auto& node : state_.actors) actor_ids_.insert(node.key());
+  }
+  BackgroundLevel(const BackgroundLevel&) = delete;
+  BackgroundLevel& operator=(const BackgroundLevel&) = delete;
+  ~BackgroundLevel() {
+    // The scheduler finishes every queued task when it stops, so there is nothing left to wait for once it is gone.
+    if (!group_.done()) scheduler_->wait(group_);
+  }
+
+  /// Have a task simulate up to `step`.  This never blocks when there is a scheduler.
+  void advance_to(int step) {
+    target_step_.store(step, std::memory_order_release);
+    if (!scheduler_) {
+      catch_up();
+      return;
+    }
+    if (running_.exchange(true, std::memory_order_acq_rel)) return;  // The running task picks up the new target.
+    scheduler_->run(group_, [this]() { run(); });
+  }
+
+  /// Finish any requested steps and return the simulated state.
+  [[nodiscard]] auto stop() -> BackgroundLevelState {
+    if (scheduler_) scheduler_->wait(group_);
+    return std::move(state_);
+  }
+
+  /// Return true if this level holds the actor `id`.  Safe to call while a task is running.
+  [[nodiscard]] auto owns(ActorID id) const -> bool { return actor_ids_.contains(id); }
+  [[nodiscard]] auto get_start_turn() const noexcept -> int { return start_turn_; }
+
+ private:
+  void catch_up() {
+    const int target = target_step_.load(std::memory_order_acquire);
+    while (state_.steps < target) {
+      step_(state_);
+      ++state_.steps;
+    }
+  }
+  /// The task of this level, at most one is queued or running at a time.
+  void run() {
+    while (true) {
+      catch_up();
+      const int steps = state_.steps;  // A new task may own the state once `running_` is cleared.
+      running_.store(false, std::memory_order_release);
+      // A target set after catching up but before `running_` was cleared did not queue a task, so run it here.
+      if (steps >= target_step_.load(std::memory_order_acquire)) return;
+      if (running_.exchange(true, std::memory_order_acq_rel)) return;
+    }
+  }
+
+  BackgroundLevelState state_;
+  int start_turn_;  // World::turn when this level was frozen.
+  StepFunction step_;
+  jobs::Scheduler* scheduler_;
+  std::unordered_set<ActorID> actor_ids_;  // Constant after construction.
+  std::atomic<int> target_step_{0};
+  std::atomic<bool> running_{false};  // True while a task of this level is queued or running.
+  jobs::WaitGroup group_;
+};
@@ -1,7 +1,10 @@
 #pragma once
 #include <cassert>
+#include <climits>
+#include <cstddef>
 #include <libtcod.hpp>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -25,6 +28,9 @@ struct Map {
   std::unordered_multimap<Position, std::unique_ptr<Item>> items;
   std::unordered_map<Position, Fixture> fixtures;
   std::vector<ActorID> frozen_actors;
+  // Set whenever anything saved changes, cleared once this map is saved to `segment`.  Neither is serialized.
+  bool dirty = true;
+  std::string segment;  // The save segment file this map was last saved to, see save_segments.hpp.
 
   Map() = default;
   Map(int width, int height) : tiles{{width, height}}, explored{{width, height}}, visible{{width, height}} {}
@@ -38,3 +44,19 @@ struct Map {
   auto get_width() const noexcept -> int { return get_size().at(0); }
   auto get_height() const noexcept -> int { return get_size().at(1); }
 };
+
+/// Return roughly how many bytes `map` holds.  Hash table nodes and items are estimated, frozen actors are not counted.
+inline auto get_memory_footprint(const Map& map) -> size_t {
+  constexpr size_t NODE_OVERHEAD = 2 * sizeof(void*);  // The next pointer and cached hash of a hash table node.
+  auto bytes = sizeof(Map);
+  bytes += map.tiles.get_container().capacity() * sizeof(Tiles);
+  bytes += (map.explored.get_container().capacity() + map.visible.get_container().capacity()) / CHAR_BIT;
+  bytes += map.items.bucket_count() * sizeof(void*);
+  bytes += map.items.size() * (sizeof(decltype(map.items)::value_type) + NODE_OVERHEAD + sizeof(Item));
+  bytes += map.fixtures.bucket_count() * sizeof(void*);
+  for (const auto& [pos, fixture] : map.fixtures) {
+    bytes += sizeof(decltype(map.fixtures)::value_type) + NODE_OVERHEAD + fixture.name.capacity();
+  }
+  bytes += map.frozen_actors.capacity() * sizeof(ActorID) + map.segment.capacity();
+  return bytes;
+}
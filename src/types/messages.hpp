@@ -5,6 +5,8 @@
 #include <vector>
 
 #include "../constants.hpp"
+#include "../memory_stats.hpp"
+#include "../perf_stats.hpp"
 
 struct Message {
   std::string text;
@@ -14,6 +16,8 @@ struct Message {
 
 struct MessageLog {
   void append(std::string const& text, tcod::ColorRGB fg = constants::TEXT_COLOR_DEFAULT) {
+    const memstats::Scope memory_scope{memstats::Subsystem::message_log};
+    const perfstats::Timer timer{perfstats::Metric::message_log};
     if (!messages.empty() && messages.back().text == text && messages.back().fg == fg) {
       ++messages.back().count;
       return;
@@ -1,19 +1,106 @@
 #pragma once
 #include <array>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace util {
+/*****************************************************************************
+    Storage layouts of Matrix and Array2D, which map an index to its position in the underlying container.
+
+    A layout is a stateless policy with `get_size(shape)`, the number of elements to store including any padding,
+    and `get_index(shape, index)`, the position of `index`.  All layouts share the same index API, so a layer can
+    switch layout without changing the code which uses it.
+
+    RowMajorLayout is the default.  The first index varies fastest, so for {x, y} each row is contiguous and rows,
+    spans and views are available.  TiledLayout and MortonLayout keep vertical neighbors close in memory, which helps
+    neighborhood-heavy work on maps too big for the cache.  They iterate in storage order, padding included, so
+    begin/end only suit filling and copying whole arrays of those layouts.
+ */
+/// Row-major storage, with the first index varying fastest.
+struct RowMajorLayout {
+  static constexpr bool is_row_major = true;
+  template <size_t Dimensions>
+  static auto get_size(const std::array<int, Dimensions>& shape) noexcept -> size_t {
+    size_t size = 1;
+    for (auto& it : shape) size *= it;
+    return size;
+  }
+  template <size_t Dimensions>
+  static auto get_index(
+      const std::array<int, Dimensions>& shape, const std::array<int, Dimensions>& index) noexcept -> size_t {
+    size_t stride = 1;
+    size_t data_index = 0;
+    for (size_t dimension = 0; dimension < Dimensions; ++dimension) {
+      data_index += stride * index[dimension];
+      stride *= shape[dimension];
+    }
+    return data_index;
+  }
+};
+
+/// 2D storage in square tiles of `TileSize` by `TileSize`, tiles and the elements within them in row-major order.
+/// The shape is padded up to whole tiles.
+template <int TileSize = 8>
+struct TiledLayout {
+  static_assert(TileSize > 0 && (TileSize & (TileSize - 1)) == 0, "TileSize must be a power of two.");
+  static constexpr bool is_row_major = false;
+  static auto get_size(const std::array<int, 2>& shape) noexcept -> size_t {
+    return static_cast<size_t>(get_tiles(shape[0])) * get_tiles(shape[1]) * TileSize * TileSize;
+  }
+  static auto get_index(const std::array<int, 2>& shape, const std::array<int, 2>& index) noexcept -> size_t {
+    // Unsigned, so the divisions by powers of two compile to shifts and masks.
+    const auto x = static_cast<size_t>(static_cast<unsigned>(index[0]));
+    const auto y = static_cast<size_t>(static_cast<unsigned>(index[1]));
+    const auto tile = (y / TileSize) * get_tiles(shape[0]) + x / TileSize;
+    return tile * TileSize * TileSize + (y % TileSize) * TileSize + x % TileSize;
+  }
+
+ private:
+  static constexpr auto get_tiles(int length) noexcept -> int { return (length + TileSize - 1) / TileSize; }
+};
+
+/// 2D storage in Z-order, the bits of x and y interleaved, so each power of two sized block is contiguous.
+/// Sides up to 65536 are supported.  Sides which are not powers of two leave unused gaps, up to about 3 times the
+/// elements for square shapes and far more for elongated ones, which suit TiledLayout better.
+struct MortonLayout {
+  static constexpr bool is_row_major = false;
+  static auto get_size(const std::array<int, 2>& shape) noexcept -> size_t {
+    if (shape[0] <= 0 || shape[1] <= 0) return 0;
+    return get_index(shape, {shape[0] - 1, shape[1] - 1}) + 1;  // The last index is the furthest one.
+  }
+  static auto get_index(const std::array<int, 2>&, const std::array<int, 2>& index) noexcept -> size_t {
+    return spread_bits(static_cast<uint32_t>(index[0])) | (spread_bits(static_cast<uint32_t>(index[1])) << 1);
+  }
+
+ private:
+  /// Return the low 16 bits of `n` moved to the even bits.
+  static constexpr auto spread_bits(uint32_t n) noexcept -> size_t {
+    n &= 0x0000'FFFF;
+    n = (n | (n << 8)) & 0x00FF'00FF;
+    n = (n | (n << 4)) & 0x0F0F'0F0F;
+    n = (n | (n << 2)) & 0x3333'3333;
+    n = (n | (n << 1)) & 0x5555'5555;
+    return n;
+  }
+};
+
 /*****************************************************************************
     @brief A template container for holding a multi-dimensional array of items.
 
     @tparam T The type of value contained by this matrix.
     @tparam Dimensions The number of dimensions of this matrix type.
+    @tparam Layout How elements are stored, see RowMajorLayout.  Other layouts only support 2 dimensions.
 
     This class is a work-in-progress.
  */
-template <typename T, size_t Dimensions>
+template <typename T, size_t Dimensions, typename Layout = RowMajorLayout>
 class Matrix {
  public:
   using size_type = int;  // The int size of indexes.
@@ -55,20 +142,8 @@ class Matrix {
   }
 
  private:
-  static size_t get_size_from_shape(const shape_type& shape) noexcept {
-    size_t size = 1;
-    for (auto& it : shape) size *= it;
-    return size;
-  }
-  size_t get_index(const index_type& index) const noexcept {
-    size_t stride = 1;
-    size_t data_index = 0;
-    for (size_t dimension = 0; dimension < Dimensions; ++dimension) {
-      data_index += stride * index.at(dimension);
-      stride *= shape_.at(dimension);
-    }
-    return data_index;
-  }
+  static size_t get_size_from_shape(const shape_type& shape) noexcept { return Layout::get_size(shape); }
+  size_t get_index(const index_type& index) const noexcept { return Layout::get_index(shape_, index); }
   size_t check_range(const index_type& index) const {
     if (!in_bounds(index)) {
       throw std::out_of_range(
@@ -92,31 +167,146 @@ class Matrix {
   shape_type shape_;
   container_type data_;
 };
-/// Simple-ish dynamically-sized 2D array type.
+/*****************************************************************************
+    @brief A window into a row-major 2D array which does not own its elements.
+
+    @tparam T The type of value viewed, const for a read-only view.
+
+    Rows are `stride` elements apart, so a subview shares the memory of the array it was taken from.  The viewed
+    array must outlive the view and must not be resized while it is viewed.
+ */
 template <typename T>
+class Array2DView {
+ public:
+  using size_type = int;  // The int size of indexes.
+  using shape_type = std::array<size_type, 2>;  // The type used to measure the views shape.
+  using index_type = std::array<size_type, 2>;  // The type used to index the view.
+  using reference = T&;
+  Array2DView() = default;
+  /// View `shape` elements at `data` with rows `stride` elements apart, or `shape[0]` if not given.
+  Array2DView(T* data, const shape_type& shape, size_type stride = 0) noexcept
+      : data_{data}, shape_{shape}, stride_{stride ? stride : shape.at(0)} {}
+  /// Views of mutable elements convert to views of const elements.
+  template <typename U>
+    requires std::is_convertible_v<U (*)[], T (*)[]>
+  Array2DView(const Array2DView<U>& other) noexcept
+      : data_{other.data()}, shape_{other.get_shape()}, stride_{other.get_stride()} {}
+
+  /// Unchecked access, asserted in debug builds.
+  reference operator[](const index_type& index) const noexcept {
+    assert(in_bounds(index));
+    return data_[get_index(index)];
+  }
+  reference at(const index_type& index) const {
+    if (!in_bounds(index)) {
+      throw std::out_of_range(
+          "Out of bounds lookup {" + std::to_string(index.at(0)) + ", " + std::to_string(index.at(1)) +
+          "} on view of shape {" + std::to_string(shape_.at(0)) + ", " + std::to_string(shape_.at(1)) + "}.");
+    }
+    return data_[get_index(index)];
+  }
+
+  /// Return row `y` of this view.
+  std::span<T> row(size_type y) const noexcept {
+    assert(0 <= y && y < shape_.at(1));
+    return {data_ + static_cast<size_t>(y) * stride_, static_cast<size_t>(shape_.at(0))};
+  }
+  /// Return the window of `shape` starting at `origin` of this view, which must fit inside of it.
+  Array2DView subview(const index_type& origin, const shape_type& shape) const noexcept {
+    assert(0 <= origin.at(0) && 0 <= shape.at(0) && origin.at(0) + shape.at(0) <= shape_.at(0));
+    assert(0 <= origin.at(1) && 0 <= shape.at(1) && origin.at(1) + shape.at(1) <= shape_.at(1));
+    return {data_ + get_index(origin), shape, stride_};
+  }
+
+  const shape_type& get_shape() const noexcept { return shape_; }
+  bool in_bounds(const index_type& index) const noexcept {
+    return 0 <= index.at(0) && index.at(0) < shape_.at(0) && 0 <= index.at(1) && index.at(1) < shape_.at(1);
+  }
+  size_type get_width() const noexcept { return shape_.at(0); }
+  size_type get_height() const noexcept { return shape_.at(1); }
+  size_type get_stride() const noexcept { return stride_; }
+  T* data() const noexcept { return data_; }
+
+ private:
+  size_t get_index(const index_type& index) const noexcept {
+    return static_cast<size_t>(index.at(1)) * stride_ + index.at(0);
+  }
+  T* data_ = nullptr;
+  shape_type shape_{0, 0};
+  size_type stride_ = 0;
+};
+
+/// Simple-ish dynamically-sized 2D array type.
+/// `Layout` picks how elements are stored, see RowMajorLayout.  Rows, spans and views need the row-major default.
+template <typename T, typename Allocator = std::allocator<T>, typename Layout = RowMajorLayout>
 class Array2D {
  public:
   using size_type = int;  // The int size of indexes.
   using shape_type = std::array<size_type, 2>;  // The type used to measure the matrixes shape.
   using index_type = std::array<size_type, 2>;  // The type used to index the container.
-  using container_type = std::vector<T>;  // The underlying container type.
+  using allocator_type = Allocator;
+  using layout_type = Layout;
+  using container_type = std::vector<T, Allocator>;  // The underlying container type.
   using reference = typename container_type::reference;
   using const_reference = typename container_type::const_reference;
   Array2D() = default;
-  explicit Array2D(const shape_type& shape) : shape_(shape), data_(get_size_from_shape(shape)) {}
-  Array2D(const shape_type& shape, const T& fill_value)
-      : shape_(shape), data_(get_size_from_shape(shape), fill_value) {}
+  explicit Array2D(const shape_type& shape, const Allocator& allocator = Allocator{})
+      : shape_(shape), data_(get_size_from_shape(shape), allocator) {}
+  Array2D(const shape_type& shape, const T& fill_value, const Allocator& allocator = Allocator{})
+      : shape_(shape), data_(get_size_from_shape(shape), fill_value, allocator) {}
   auto begin() noexcept { return data_.begin(); }
   auto begin() const noexcept { return data_.cbegin(); }
   auto end() noexcept { return data_.end(); }
   auto end() const noexcept { return data_.cend(); }
 
-  reference operator[](const index_type& index) noexcept { return data_[get_index(index)]; }
-  const_reference operator[](const index_type& index) const noexcept { return data_[get_index(index)]; }
+  /// Unchecked access, asserted in debug builds.  Use `at` where the index might be out of bounds.
+  reference operator[](const index_type& index) noexcept {
+    assert(in_bounds(index));
+    return data_[get_index(index)];
+  }
+  const_reference operator[](const index_type& index) const noexcept {
+    assert(in_bounds(index));
+    return data_[get_index(index)];
+  }
 
   reference at(const index_type& index) { return data_.at(check_range(index)); }
   const_reference at(const index_type& index) const { return data_.at(check_range(index)); }
 
+  /// Return row `y` as a span.  Only for the row-major layout, and not for bool since std::vector<bool> packs its
+  /// elements into bits.
+  std::span<T> row(size_type y) noexcept
+    requires(Layout::is_row_major && !std::is_same_v<T, bool>)
+  {
+    return view().row(y);
+  }
+  std::span<const T> row(size_type y) const noexcept
+    requires(Layout::is_row_major && !std::is_same_v<T, bool>)
+  {
+    return view().row(y);
+  }
+  /// Return a view of this whole array.
+  Array2DView<T> view() noexcept
+    requires(Layout::is_row_major && !std::is_same_v<T, bool>)
+  {
+    return {data_.data(), shape_};
+  }
+  Array2DView<const T> view() const noexcept
+    requires(Layout::is_row_major && !std::is_same_v<T, bool>)
+  {
+    return {data_.data(), shape_};
+  }
+  /// Return a view of the window of `shape` starting at `origin`, which must fit inside of this array.
+  Array2DView<T> subview(const index_type& origin, const shape_type& shape) noexcept
+    requires(Layout::is_row_major && !std::is_same_v<T, bool>)
+  {
+    return view().subview(origin, shape);
+  }
+  Array2DView<const T> subview(const index_type& origin, const shape_type& shape) const noexcept
+    requires(Layout::is_row_major && !std::is_same_v<T, bool>)
+  {
+    return view().subview(origin, shape);
+  }
+
   const shape_type& get_shape() const noexcept { return shape_; }
   bool in_bounds(const index_type& index) const noexcept {
     return 0 <= index.at(0) && index.at(0) < shape_.at(0) && 0 <= index.at(1) && index.at(1) < shape_.at(1);
@@ -133,8 +323,8 @@ class Array2D {
   }
 
  private:
-  static size_t get_size_from_shape(const shape_type& shape) noexcept { return shape.at(0) * shape.at(1); }
-  size_t get_index(const index_type& index) const noexcept { return index.at(1) * shape_.at(0) + index.at(0); }
+  static size_t get_size_from_shape(const shape_type& shape) noexcept { return Layout::get_size(shape); }
+  size_t get_index(const index_type& index) const noexcept { return Layout::get_index(shape_, index); }
   size_t check_range(const index_type& index) const {
     if (!in_bounds(index)) {
       throw std::out_of_range(
@@ -158,4 +348,28 @@ class Array2D {
   shape_type shape_;
   container_type data_;
 };
+
+/// Call `func` with the elements at each index of `first` and `rest`, such as several layers of a map.
+/// Every array or view given must have the same shape.  Elements are visited row by row.
+template <typename Func, typename First, typename... Rest>
+inline void zip(Func&& func, First&& first, Rest&&... rest) {
+  assert(((first.get_shape() == rest.get_shape()) && ...));
+  const auto [width, height] = first.get_shape();
+  for (int y{0}; y < height; ++y) {
+    for (int x{0}; x < width; ++x) func(first[{x, y}], rest[{x, y}]...);
+  }
+}
+
+/// An Array2D stored in tiles, see TiledLayout.
+template <typename T, int TileSize = 8>
+using TiledArray2D = Array2D<T, std::allocator<T>, TiledLayout<TileSize>>;
+/// An Array2D stored in Z-order, see MortonLayout.
+template <typename T>
+using MortonArray2D = Array2D<T, std::allocator<T>, MortonLayout>;
+
+namespace pmr {
+/// An Array2D allocating from a memory resource, such as the per-turn arena in turn_arena.hpp.
+template <typename T>
+using Array2D = util::Array2D<T, std::pmr::polymorphic_allocator<T>>;
+}  // namespace pmr
 }  // namespace util
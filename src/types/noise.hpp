@@ -0,0 +1,8 @@
+#pragma once
+#include "position.hpp"
+
+/// A sound made this turn which can wake dormant actors.
+struct Noise {
+  Position pos;
+  int volume;  // How far this travels in pathfinding distance, cardinal steps cost 2 and diagonal steps cost 3.
+};
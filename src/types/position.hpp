@@ -1,6 +1,8 @@
 #pragma once
 #include <array>
 #include <compare>
+#include <cstddef>
+#include <cstdint>
 
 struct Position {
   // Allow this struct to be used in subscript operators as {x, y}.
@@ -14,5 +16,11 @@ struct Position {
 };
 template <>
 struct std::hash<Position> {
-  std::size_t operator()(const Position& pos) const { return pos.x + pos.y * 97; }
+  /// Mix both coordinates into every bit, so that nearby positions spread over the buckets of large indexes.
+  std::size_t operator()(const Position& pos) const noexcept {
+    auto key = (uint64_t{static_cast<uint32_t>(pos.x)} << 32) | static_cast<uint32_t>(pos.y);
+    key = (key ^ (key >> 30)) * 0xBF58'476D'1CE4'E5B9;  // The splitmix64 finalizer.
+    key = (key ^ (key >> 27)) * 0x94D0'49BB'1331'11EB;
+    return static_cast<std::size_t>(key ^ (key >> 31));
+  }
 };
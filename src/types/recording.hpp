@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+#include "../json.hpp"
+#include "../procgen/level_params.hpp"
+#include "../xp.hpp"
+#include "position.hpp"
+
+namespace replay {
+/// Player commands, recorded in the order they were given.
+struct Bump {
+  Position dir;
+};
+struct Pickup {};
+struct UseItem {
+  int item_index;
+};
+struct UseStairs {
+  bool downwards;
+};
+struct PickTile {
+  Position target;  // The tile picked for the item used by the previous command.
+};
+struct LevelUp {
+  LevelUpStat stat;
+};
+struct RegenerateLevel {};  // Debug command.
+struct RevealMap {};  // Debug command.
+using Command = std::variant<Bump, Pickup, UseItem, UseStairs, PickTile, LevelUp, RegenerateLevel, RevealMap>;
+
+/// A recorded session which can be replayed to reach the same world state.
+struct Recording {
+  static constexpr int VERSION = 1;
+  json start;  // The World when recording began, this includes the state of World::rng.
+  bool simulate_frozen_levels = false;
+  procgen::LevelParams level_params;  // Used for levels generated during the session.
+  std::vector<Command> commands;
+  int turns = 0;  // World::turn when recording ended.
+  uint64_t checksum = 0;  // The world_checksum when recording ended.
+};
+}  // namespace replay
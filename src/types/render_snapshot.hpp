@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <libtcod.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "map_id.hpp"
+#include "messages.hpp"
+#include "ndarray.hpp"
+#include "position.hpp"
+
+/// Everything needed to draw the game, copied out of the World so that drawing never touches the simulation.
+struct RenderSnapshot {
+  int turn = 0;  // The World::turn this was taken on.
+  util::Array2D<TCOD_ConsoleTile> tiles;  // The map with fixtures, items and actors, ch is 0 where unexplored.
+  util::Array2D<bool> visible;
+  std::vector<std::pair<Position, std::string>> names;  // Names of visible fixtures and actors for mouse look.
+  std::vector<Message> log_tail;  // The newest log messages, oldest first.
+  std::vector<std::pair<std::string, int>> inventory;  // The name and count of each item held by the player.
+  int hp = 0;
+  int max_hp = 0;
+  int xp = 0;
+  int level = 1;
+  size_t active_actors = 0;  // Actors taking turns, for the performance overlay.
+  std::vector<std::pair<MapID, size_t>> map_memory;  // The approximate bytes of each loaded map, sorted by ID.
+  size_t unloaded_maps = 0;  // Saved maps not decoded yet.
+};
@@ -1,22 +1,68 @@
 #pragma once
 #include <deque>
+#include <memory>
 #include <random>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "actor.hpp"
 #include "actor_id.hpp"
+#include "background_level.hpp"
 #include "map.hpp"
 #include "messages.hpp"
+#include "noise.hpp"
+
+struct World;
+
+/// Decodes maps which were saved but not loaded yet, see save_segments.hpp.
+class MapLoader {
+ public:
+  virtual ~MapLoader() = default;
+  /// Decode the map `map_id` saved in `segment` into `world`, along with the actors frozen in it.
+  virtual auto load(World& world, const MapID& map_id, const std::string& segment) -> void = 0;
+};
+
+/// A saved map which was not decoded yet.
+struct UnloadedMap {
+  std::string segment;  // The segment file holding the map.
+  std::vector<ActorID> frozen_actors;  // The actors saved with the map.
+};
 
 struct World {
   MessageLog log;
   std::mt19937 rng;
+  int turn = 0;  // The number of turns which have passed.
   std::deque<ActorID> schedule;
   MapID current_map_id = {"", 0};
-  std::unordered_map<MapID, Map> maps;
+  std::unordered_map<MapID, Map> maps;  // Loaded maps, use `find_map` for maps which might not be loaded yet.
+  std::unordered_map<MapID, UnloadedMap> unloaded_maps;  // Saved maps decoded on first use.
+  std::unique_ptr<MapLoader> map_loader;  // Decodes `unloaded_maps`.  Not serialized.
+  // The IDs of every actor frozen in `unloaded_maps`, which new actors must not take.  Not serialized.
+  std::unordered_set<ActorID> unloaded_actors;
   std::unordered_map<ActorID, Actor> actors;
   std::unordered_set<ActorID> active_actors;
+  std::unordered_set<ActorID> dormant_actors;  // Active actors which are not scheduled until a noise wakes them.
+  std::vector<Noise> noises;  // Noises made since the last enemy turn, not serialized.
+  std::unordered_multimap<Position, ActorID> actor_positions;  // Spatial index of active actors, not serialized.
+  // Frozen levels still being simulated, these own their actors until reclaimed.  Not serialized.
+  std::unordered_map<MapID, std::unique_ptr<BackgroundLevel>> background_levels;
+
+  /// Return the map `map_id`, decoding it first if it was not loaded yet.  Returns nullptr if there is no such map.
+  auto find_map(const MapID& map_id) -> Map* {
+    if (auto unloaded = unloaded_maps.find(map_id); unloaded != unloaded_maps.end()) {
+      map_loader->load(*this, map_id, unloaded->second.segment);
+      for (const auto actor_id : unloaded->second.frozen_actors) unloaded_actors.erase(actor_id);
+      unloaded_maps.erase(unloaded);
+    }
+    auto found = maps.find(map_id);
+    return found != maps.end() ? &found->second : nullptr;
+  }
+  /// Decode every map which was not loaded yet.  Needed before anything which iterates over `maps`.
+  auto load_all_maps() -> void {
+    while (!unloaded_maps.empty()) find_map(MapID{unloaded_maps.begin()->first});
+  }
 
   auto active_map() -> Map& { return maps.at(current_map_id); }
   auto active_map() const -> const Map& { return maps.at(current_map_id); }
@@ -2,16 +2,22 @@
 #include <memory>
 #include <random>
 
+#include "actor_index.hpp"
 #include "constants.hpp"
+#include "memory_stats.hpp"
 #include "procgen/caves.hpp"
 #include "types/world.hpp"
 
 /// Create a new world with procedurally generated dungeon
-inline auto new_world() -> std::unique_ptr<World> {
+inline auto new_world(
+    std::mt19937::result_type seed = std::random_device{}(),
+    const procgen::LevelParams& first_level = {},
+    jobs::Scheduler* scheduler = nullptr) -> std::unique_ptr<World> {
+  const memstats::Scope memory_scope{memstats::Subsystem::procgen};
   auto world = std::make_unique<World>();
 
   // Initialize RNG
-  world->rng.seed(std::random_device{}());
+  world->rng.seed(seed);
 
   // Create player actor
   Actor player;
@@ -28,10 +34,11 @@ inline auto new_world() -> std::unique_ptr<World> {
 
   world->actors[ActorID{0}] = std::move(player);
   world->active_actors.insert(ActorID{0});
+  index_actor(*world, world->active_player());
   world->schedule.push_back(ActorID{0});
 
   // Generate first level using procedural generation
-  procgen::generate_level(*world, 1);
+  procgen::generate_level(*world, 1, first_level, false, scheduler);
 
   world->log.append("Welcome to the dungeon!", constants::TEXT_COLOR_DEFAULT);
 
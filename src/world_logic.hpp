@@ -2,10 +2,17 @@
 #include <fmt/core.h>
 
 #include <gsl/gsl>
+#include <memory_resource>
 #include <ranges>
 
+#include "actor_index.hpp"
+#include "background_levels.hpp"
 #include "distance.hpp"
 #include "globals.hpp"
+#include "memory_stats.hpp"
+#include "noise.hpp"
+#include "perf_stats.hpp"
+#include "trace.hpp"
 #include "types/actor.hpp"
 #include "types/world.hpp"
 
@@ -14,6 +21,7 @@ inline auto new_actor(World& world) {
   while (true) {
     // RNG's need to be narrowed on some implementations.
     auto new_id = ActorID{gsl::narrow<std::underlying_type_t<ActorID>>(world.rng())};
+    if (background::owns(world, new_id) || world.unloaded_actors.contains(new_id)) continue;
     auto [iterator, success] = world.actors.try_emplace(new_id, Actor{});
     if (success) {
       iterator->second.id = new_id;
@@ -23,37 +31,74 @@ inline auto new_actor(World& world) {
 }
 
 inline auto enemy_turn(GameContext& context) -> void {
+  const trace::Zone trace_zone{"enemy_turn"};
   auto& world = *context.world;
   assert(world.schedule.front() == ActorID{0});
 
+  // Only actors which can hear the player or a fight are scheduled, everything else sleeps until woken.
+  // This keeps the cost of a turn proportional to the number of engaged actors instead of the level population.
+  auto& arena = context.turn_arena.local();
+  const auto heard = noise::compute_field(world, arena);
+  world.noises.clear();
+  noise::wake_actors(world, heard);
+
   world.schedule.push_back(world.schedule.front());
   world.schedule.pop_front();
 
-  int safety_count = 0;
-  while (world.schedule.front() != ActorID{0} && world.actors.contains(ActorID{0})) {
-    if (++safety_count > 1000) {
-      fmt::print("Warning: Enemy turn loop exceeded 1000 iterations. Breaking to prevent hang.\n");
-      break;
+  // Plan every scheduled actor in parallel before any of them act.  Plans only read the world.
+  auto planners = std::pmr::vector<Actor*>{&arena};
+  planners.reserve(world.schedule.size());
+  for (auto actor_id : world.schedule) {
+    if (auto found = world.actors.find(actor_id); found != world.actors.end() && found->second.ai) {
+      planners.emplace_back(&found->second);
     }
+  }
+  const auto plan = [&context, &world, &planners](int i) {
+    const trace::Zone trace_zone{"plan"};
+    const memstats::Scope memory_scope{memstats::Subsystem::ai};
+    const perfstats::Scope perf_scope{context.perf_stats};  // Planning may run on a worker thread.
+    const perfstats::Timer timer{perfstats::Metric::ai};
+    planners.at(i)->ai->plan(world, *planners.at(i), context.turn_arena.local());
+  };
+  jobs::parallel_for(&context.scheduler, 0, static_cast<int>(planners.size()), 16, plan);
+
+  // Every scheduled actor acts at most once per call, so the schedule size bounds this loop even if the player is
+  // missing from the schedule.
+  for (auto remaining = world.schedule.size();
+       remaining && world.schedule.front() != ActorID{0} && world.actors.contains(ActorID{0});
+       --remaining) {
     auto actor_id = world.schedule.front();
     world.schedule.pop_front();
     auto actor_it = world.actors.find(actor_id);
     if (actor_it == world.actors.end()) {
+#ifndef NDEBUG
       fmt::print(
-          "Dropped missing actor {:0X} from schedule.\n", static_cast<std::underlying_type_t<ActorID>>(actor_id));
+          stderr,
+          "Dropped missing actor {:0X} from schedule.\n",
+          static_cast<std::underlying_type_t<ActorID>>(actor_id));
+#endif
       continue;
     }
     if (auto& actor = actor_it->second; actor.ai) {
+      const trace::Zone trace_zone{"perform"};
+      const memstats::Scope memory_scope{memstats::Subsystem::ai};
+      const perfstats::Timer timer{perfstats::Metric::ai};
       const auto result = actor.ai->perform(context, actor);
       if (std::holds_alternative<action::Failure>(result)) {
-        fmt::print("AI failed action: {}\n", std::get<action::Failure>(result).reason);
+        fmt::print(stderr, "AI failed action: {}\n", std::get<action::Failure>(result).reason);
       } else if (std::holds_alternative<action::Success>(result)) {
       } else {
         assert(0);
       }
+      if (!heard.hears(actor.pos)) {
+        world.dormant_actors.insert(actor_id);
+        continue;
+      }
     }
     world.schedule.push_back(actor_id);
   }
+  ++world.turn;
+  background::advance(world);
 }
 /// Return a pointer to the actor closest to `pos`.
 template <typename DistType = int, typename DistFunc, typename ValidActorFunc>
@@ -89,9 +134,8 @@ inline auto get_nearest_actor(
 
 /// Return a pointer to an Actor at `pos` if it exists.
 inline auto actor_at(World& world, Position pos) -> Actor* {
-  auto actors = world.active_actors | std::views::transform([&world](auto id) { return &world.get(id); });
-  auto it = std::ranges::find_if(actors, [&](auto* a) { return a->pos == pos; });
-  return (it != actors.end()) ? *it : nullptr;
+  const auto actor_id = find_actor_id_at(world, pos);
+  return actor_id ? &world.get(*actor_id) : nullptr;
 }
 
 /// Call function (Actor&) -> void on all active actors.
@@ -107,18 +151,28 @@ inline auto with_active_actors(const World& world, const WithActorFunc function)
 /// Call function (Actor&) -> void on any actors at `pos`.
 template <typename WithActorFunc>
 inline auto with_actors_at(World& world, Position pos, const WithActorFunc function) {
-  with_active_actors(world, [&pos, &function](Actor& actor) {
-    if (actor.pos == pos) function(actor);
-  });
+  // Copy the IDs first since `function` may move or destroy actors.
+  auto actor_ids = std::vector<ActorID>{};
+  for (auto [it, last] = world.actor_positions.equal_range(pos); it != last; ++it) actor_ids.emplace_back(it->second);
+  for (auto actor_id : actor_ids) function(world.get(actor_id));
 }
 
-inline auto freeze_map(World& world, Map& map) -> void {
-  for (auto actor_id : world.schedule) {
-    if (actor_id == ActorID{0}) continue;  // Is player.
+/// Deactivate the actors of the active map, storing them in `map`.
+/// If `simulate` is true then those actors keep running as tasks on `scheduler` until the map is activated again.
+inline auto freeze_map(World& world, Map& map, bool simulate = false, jobs::Scheduler* scheduler = nullptr) -> void {
+  const auto freeze_actor = [&world, &map](ActorID actor_id) {
+    if (actor_id == ActorID{0}) return;  // Is player.
     map.frozen_actors.emplace_back(actor_id);
+    if (auto found = world.actors.find(actor_id); found != world.actors.end()) unindex_actor(world, found->second);
     world.active_actors.erase(actor_id);
-  }
+  };
+  for (auto actor_id : world.schedule) freeze_actor(actor_id);
+  for (auto actor_id : world.dormant_actors) freeze_actor(actor_id);
   world.schedule = {ActorID{0}};
+  world.dormant_actors = {};
+  world.noises = {};
+  map.dirty = true;
+  if (simulate) background::start(world, map, scheduler);
 }
 
 inline auto find_fixture_by_name(const Map& map, std::string_view name) -> std::optional<Position> {
@@ -128,12 +182,21 @@ inline auto find_fixture_by_name(const Map& map, std::string_view name) -> std::
   return {};
 }
 
-inline auto activate_map(World& world, Map& map) -> void {
-  if (auto found = world.maps.find(world.current_map_id); found != world.maps.end()) freeze_map(world, found->second);
+/// Make `map` the active map, freezing the previously active map.
+/// Actors of a map which was simulated in the background are reclaimed with their simulated state.
+inline auto activate_map(
+    World& world, Map& map, bool simulate_frozen = false, jobs::Scheduler* scheduler = nullptr) -> void {
+  if (map.id == world.current_map_id) return;
+  if (auto found = world.maps.find(world.current_map_id); found != world.maps.end()) {
+    freeze_map(world, found->second, simulate_frozen, scheduler);
+  }
+  background::reclaim(world, map.id);
   for (auto actor_id : map.frozen_actors) {
-    world.schedule.emplace_back(actor_id);
+    world.dormant_actors.emplace(actor_id);  // Woken by the next enemy turn if close enough.
     world.active_actors.emplace(actor_id);
+    if (auto found = world.actors.find(actor_id); found != world.actors.end()) index_actor(world, found->second);
   }
   map.frozen_actors = {};
+  map.dirty = true;
   world.current_map_id = map.id;
 }
@@ -1,7 +1,34 @@
 #pragma once
 
+#include "types/stats.hpp"
+
 inline auto next_level_xp(int level) -> int {
   const int LEVEL_UP_BASE = 200;
   const int LEVEL_UP_FACTOR = 150;
   return LEVEL_UP_BASE + level * LEVEL_UP_FACTOR;
 }
+
+/// The stats which can be improved when leveling up.
+enum class LevelUpStat {
+  constitution = 0,  // +20 HP
+  strength,  // +1 attack
+  agility,  // +1 defense
+};
+
+/// Spend the XP for the next level on improving `stat`.
+inline auto level_up(Stats& stats, LevelUpStat stat) -> void {
+  switch (stat) {
+    case LevelUpStat::constitution:
+      stats.hp += 20;
+      stats.max_hp += 20;
+      break;
+    case LevelUpStat::strength:
+      stats.attack += 1;
+      break;
+    case LevelUpStat::agility:
+      stats.defense += 1;
+      break;
+  }
+  stats.xp -= next_level_xp(stats.level);
+  ++stats.level;
+}
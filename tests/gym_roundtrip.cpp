@@ -0,0 +1,136 @@
+// Checks that the gym tool speaks a clean protocol stream over stdout.
+//
+// Sends a reset, a step and a quit request to the gym executable through files, then checks that the response begins
+// with the handshake's magic bytes and holds exactly the records requested.  Diagnostics printed by the engine while
+// worlds are generated or stepped must go elsewhere, or they would corrupt the stream.
+//
+// Usage: gym_roundtrip GYM_EXECUTABLE
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gym.hpp"
+
+namespace {
+constexpr uint32_t ENV_COUNT = 2;
+constexpr int RADIUS = 3;
+
+template <typename T>
+void append(std::vector<char>& out, const T& value) {
+  const auto* bytes = reinterpret_cast<const char*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+/// Reads values from the front of a response, failing once it runs out.
+class ResponseReader {
+ public:
+  explicit ResponseReader(const std::vector<char>& data) : data_{data} {}
+
+  template <typename T>
+  [[nodiscard]] auto read() -> T {
+    auto value = T{};
+    if (remaining() < sizeof(T)) throw std::runtime_error(fmt::format("Response ends at byte {}.", pos_));
+    std::memcpy(&value, data_.data() + pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return value;
+  }
+  void skip(size_t size) {
+    if (remaining() < size) throw std::runtime_error(fmt::format("Response ends at byte {}.", data_.size()));
+    pos_ += size;
+  }
+  [[nodiscard]] auto remaining() const noexcept -> size_t { return data_.size() - pos_; }
+
+ private:
+  const std::vector<char>& data_;
+  size_t pos_ = 0;
+};
+
+/// Check one response of `count` records of `record_size` bytes each.
+void check_response(ResponseReader& in, const char* name, uint32_t count, size_t record_size) {
+  if (const auto status = in.read<uint8_t>(); status != 0) {
+    throw std::runtime_error(fmt::format("The {} request failed with status {}.", name, status));
+  }
+  in.skip(record_size * count);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fmt::print(stderr, "Usage: gym_roundtrip GYM_EXECUTABLE\n");
+    return EXIT_FAILURE;
+  }
+  const auto directory = std::filesystem::temp_directory_path();
+  const auto request_path = directory / "gym_roundtrip_request.bin";
+  const auto response_path = directory / "gym_roundtrip_response.bin";
+
+  auto request = std::vector<char>{};
+  append(request, gym::Op::reset);
+  append(request, ENV_COUNT);
+  for (uint32_t env{0}; env < ENV_COUNT; ++env) append(request, gym::ResetRecord{env, env + 1});
+  append(request, gym::Op::step);
+  append(request, ENV_COUNT);
+  for (uint32_t env{0}; env < ENV_COUNT; ++env) append(request, gym::StepRecord{env, gym::ActionType::bump, 1, 0, 0});
+  append(request, gym::Op::quit);
+  append(request, uint32_t{0});
+  std::ofstream{request_path, std::ios::binary}.write(request.data(), static_cast<std::streamsize>(request.size()));
+
+  auto command = fmt::format(
+      "\"{}\" --envs {} --radius {} < \"{}\" > \"{}\"",
+      argv[1],
+      ENV_COUNT,
+      RADIUS,
+      request_path.string(),
+      response_path.string());
+#ifdef _WIN32
+  command = fmt::format("\"{}\"", command);  // cmd.exe strips the outer quotes of a command starting with one.
+#endif
+  if (std::system(command.c_str()) != 0) {
+    fmt::print(stderr, "Failed to run: {}\n", command);
+    return EXIT_FAILURE;
+  }
+  auto file = std::ifstream{response_path, std::ios::binary};
+  const auto response = std::vector<char>{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+  try {
+    if (response.size() < gym::MAGIC.size() || !std::equal(gym::MAGIC.begin(), gym::MAGIC.end(), response.begin())) {
+      const auto start = std::string{response.begin(), response.begin() + std::min<size_t>(response.size(), 32)};
+      throw std::runtime_error(fmt::format("The response does not start with the magic bytes: {:?}", start));
+    }
+    auto in = ResponseReader{response};
+    in.skip(gym::MAGIC.size());
+    if (const auto version = in.read<uint32_t>(); version != gym::PROTOCOL_VERSION) {
+      throw std::runtime_error(fmt::format("Unexpected protocol version {}.", version));
+    }
+    if (const auto env_count = in.read<uint32_t>(); env_count != ENV_COUNT) {
+      throw std::runtime_error(fmt::format("Expected {} environments, got {}.", ENV_COUNT, env_count));
+    }
+    const auto width = in.read<uint32_t>();
+    const auto height = in.read<uint32_t>();
+    if (width != RADIUS * 2 + 1 || height != width) {
+      throw std::runtime_error(fmt::format("Unexpected observation size {}x{}.", width, height));
+    }
+    const auto observation_size =
+        gym::OBSERVATION_HEADER_SIZE + static_cast<size_t>(gym::Layer::count) * width * height;
+    check_response(in, "reset", ENV_COUNT, observation_size);
+    check_response(in, "step", ENV_COUNT, gym::STEP_HEADER_SIZE + observation_size);
+    if (in.remaining()) {
+      throw std::runtime_error(fmt::format("{} unexpected bytes after the last response.", in.remaining()));
+    }
+  } catch (const std::exception& error) {
+    fmt::print(stderr, "{}\n", error.what());
+    return EXIT_FAILURE;
+  }
+  std::filesystem::remove(request_path);
+  std::filesystem::remove(response_path);
+  fmt::print("The gym protocol round trip succeeded.\n");
+  return EXIT_SUCCESS;
+}
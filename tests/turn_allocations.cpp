@@ -0,0 +1,106 @@
+// Checks that a steady game stops allocating from the heap during turns.
+//
+// A bot plays a new game for a number of turns.  After the warm-up turns the turn arenas must have grown to fit
+// every turn, and in ALLOCATION_STATS builds the heap allocations of each turn must stay near zero.  Turns which
+// change the level are not counted since generating a level allocates by design, and neither is the message log
+// which keeps the text of every message.
+//
+// Usage: turn_allocations [--turns N] [--warmup N] [--seed N]
+#include <fmt/core.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include "bot.hpp"
+#include "globals.hpp"
+#include "headless.hpp"
+#include "memory_stats.hpp"
+#include "memory_stats_hooks.hpp"
+#include "world_init.hpp"
+
+namespace {
+constexpr double MAX_MEAN_HEAP_ALLOCATIONS = 8.0;  // Per turn, covering the player action and its message text.
+
+/// Runs another policy without charging what it allocates to the turn, so that only the game itself is measured.
+class UnchargedPolicy : public bot::Policy {
+ public:
+  explicit UnchargedPolicy(std::unique_ptr<bot::Policy> policy) : policy_{std::move(policy)} {}
+
+  [[nodiscard]] auto next_command(const World& world) -> replay::Command override {
+    auto command = policy_->next_command(world);
+    std::ignore = memstats::end_window(memstats::Window::turn);  // Discard the allocations of the bot.
+    return command;
+  }
+  [[nodiscard]] auto choose_level_up(const World& world) -> LevelUpStat override {
+    return policy_->choose_level_up(world);
+  }
+
+ private:
+  std::unique_ptr<bot::Policy> policy_;
+};
+}  // namespace
+
+int main(int argc, char** argv) {
+  int turn_count = 1000;
+  int warmup_turns = 100;
+  unsigned seed = 7;
+  for (int i{1}; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    const bool has_value = i + 1 < argc;
+    if (arg == "--turns" && has_value) {
+      turn_count = std::atoi(argv[++i]);
+    } else if (arg == "--warmup" && has_value) {
+      warmup_turns = std::atoi(argv[++i]);
+    } else if (arg == "--seed" && has_value) {
+      seed = static_cast<unsigned>(std::atoi(argv[++i]));
+    } else {
+      fmt::print(stderr, "Unknown argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto context = GameContext{};
+  context.scheduler.start(jobs::default_worker_count());
+  context.world = new_world(seed, {}, &context.scheduler);
+  auto& player = context.world->active_player();
+  player.stats.max_hp = player.stats.hp = std::numeric_limits<int>::max() / 2;  // Keep playing until the end.
+  auto policy = UnchargedPolicy{bot::make_policy("explorer", seed)};
+
+  auto level = context.world->current_map_id;
+  int measured_turns = 0;
+  int overflowed_turns = 0;
+  uint64_t heap_allocations = 0;
+  const auto report = headless::run(context, policy, turn_count, [&](int turn) {
+    const bool level_changed = level != context.world->current_map_id;
+    level = context.world->current_map_id;
+    if (turn <= warmup_turns || level_changed) return;
+    ++measured_turns;
+    if (const auto bytes = context.turn_arena.get_last_overflow_bytes()) {
+      ++overflowed_turns;
+      fmt::print(stderr, "Turn {} overflowed the turn arenas by {} bytes.\n", turn, bytes);
+    }
+    const auto allocated = memstats::get_last(memstats::Window::turn);
+    heap_allocations += memstats::get_total(allocated).allocations -
+                        allocated.at(static_cast<size_t>(memstats::Subsystem::message_log)).allocations;
+  });
+
+  bool passed = report.turns == turn_count && measured_turns > 0 && overflowed_turns == 0;
+  fmt::print(
+      "{} turns measured after {} warm-up turns, {} overflowed the turn arenas.\n",
+      measured_turns,
+      warmup_turns,
+      overflowed_turns);
+  if (memstats::ENABLED) {
+    const double mean = measured_turns ? static_cast<double>(heap_allocations) / measured_turns : 0.0;
+    fmt::print("{:.2f} heap allocations per turn, at most {:.2f} allowed.\n", mean, MAX_MEAN_HEAP_ALLOCATIONS);
+    passed = passed && mean <= MAX_MEAN_HEAP_ALLOCATIONS;
+  } else {
+    fmt::print("Heap allocations are only checked in builds configured with -DALLOCATION_STATS=ON.\n");
+  }
+  if (report.turns != turn_count) fmt::print(stderr, "Only {} of {} turns were played.\n", report.turns, turn_count);
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,113 @@
+// Monte-Carlo batches of headless games for tuning level parameters.
+//
+// Plays many independent worlds with a bot policy on every core and prints the distribution of how deep the player
+// got, how many turns they survived and how much damage they took.  The monster stats and item counts used by
+// procgen::generate_level can be changed from the command line to compare balance changes without rebuilding.
+//
+// Usage: batch [--worlds N] [--turns N] [--seed N] [--policy random|explorer] [--threads N] [--csv PATH]
+//              [--orcs N] [--trolls N] [--health-potions N] [--scrolls N]
+//              [--orc-hp N] [--orc-attack N] [--orc-defense N] [--troll-hp N] [--troll-attack N] [--troll-defense N]
+#include <fmt/core.h>
+#include <fmt/os.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string_view>
+#include <utility>
+
+#include "batch.hpp"
+#include "jobs.hpp"
+
+namespace {
+void print_distribution(std::string_view name, const batch::Distribution& dist) {
+  fmt::print(
+      "{:>14}: mean {:9.2f}  p10 {:8.0f}  p50 {:8.0f}  p90 {:8.0f}\n", name, dist.mean, dist.p10, dist.p50, dist.p90);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto options = batch::Options{};
+  unsigned threads = jobs::default_worker_count() + 1;
+  auto csv_path = std::string_view{};
+  auto& params = options.level_params;
+  const std::pair<std::string_view, int*> tunables[] = {
+      {"--orcs", &params.orcs},
+      {"--trolls", &params.trolls},
+      {"--health-potions", &params.health_potions},
+      {"--scrolls", &params.scrolls},
+      {"--orc-hp", &params.orc_stats.hp},
+      {"--orc-attack", &params.orc_stats.attack},
+      {"--orc-defense", &params.orc_stats.defense},
+      {"--troll-hp", &params.troll_stats.hp},
+      {"--troll-attack", &params.troll_stats.attack},
+      {"--troll-defense", &params.troll_stats.defense},
+  };
+  for (int i = 1; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    if (i + 1 >= argc) {
+      fmt::print(stderr, "Missing value for argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+    const char* value = argv[++i];
+    if (arg == "--worlds") {
+      options.worlds = std::atoi(value);
+    } else if (arg == "--turns") {
+      options.turns = std::atoi(value);
+    } else if (arg == "--seed") {
+      options.seed = static_cast<std::mt19937::result_type>(std::strtoul(value, nullptr, 10));
+    } else if (arg == "--policy") {
+      options.policy = value;
+    } else if (arg == "--threads") {
+      threads = std::max(1, std::atoi(value));
+    } else if (arg == "--csv") {
+      csv_path = value;
+    } else if (const auto* tunable = std::ranges::find(tunables, arg, &std::pair<std::string_view, int*>::first);
+               tunable != std::end(tunables)) {
+      *tunable->second = std::atoi(value);
+    } else {
+      fmt::print(stderr, "Unknown argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+  }
+  if (!bot::make_policy(options.policy)) {
+    fmt::print(stderr, "Unknown policy: {}\n", options.policy);
+    return EXIT_FAILURE;
+  }
+
+  auto scheduler = jobs::Scheduler{};
+  scheduler.start(threads - 1);  // The main thread runs worlds too while it waits.
+  const auto start_time = std::chrono::steady_clock::now();
+  const auto outcomes = batch::run(options, scheduler);
+  const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+  const auto summary = batch::summarize(outcomes);
+  fmt::print(
+      "{} worlds of up to {} turns in {:.3f}s ({:.1f} worlds/s) on {} threads with the {} policy.\n",
+      summary.worlds,
+      options.turns,
+      seconds,
+      seconds > 0 ? summary.worlds / seconds : 0.0,
+      threads,
+      options.policy);
+  fmt::print("{:>14}: {} ({:.1f}%)\n", "deaths", summary.deaths, 100.0 * summary.deaths / std::max(1, summary.worlds));
+  print_distribution("depth", summary.depth);
+  print_distribution("turns", summary.turns);
+  print_distribution("damage taken", summary.damage_taken);
+  print_distribution("player level", summary.player_level);
+
+  if (!csv_path.empty()) {
+    auto csv = fmt::output_file(std::string{csv_path});
+    csv.print("seed,depth,turns,damage_taken,player_level,died\n");
+    for (const auto& outcome : outcomes) {
+      csv.print(
+          "{},{},{},{},{},{}\n",
+          outcome.seed,
+          outcome.depth,
+          outcome.turns,
+          outcome.damage_taken,
+          outcome.player_level,
+          outcome.died ? 1 : 0);
+    }
+  }
+  return EXIT_SUCCESS;
+}
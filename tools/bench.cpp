@@ -0,0 +1,392 @@
+// Benchmarks of engine routines in isolation.
+//
+// Times pathfinding, field of view, cave generation, monster turns, map drawing and saving on generated maps of each
+// size and seed given, and prints the time per run.  Inputs only depend on the size and seed, so results can be
+// compared between builds to catch regressions.  See src/bench.hpp.
+//
+// The layout_ benchmarks run a cave generation step and Dijkstra through the index API of util::Array2D with each
+// storage layout.  Compare them on big maps with --sizes 2048x2048 --filter layout_.
+//
+// With --csv the results are also written to PATH with the columns name, width, height, seed, monsters, iterations,
+// min_ms, median_ms, mean_ms and max_ms.  Monsters is 0 for benchmarks without monsters.
+//
+// Usage: bench [--sizes WxH,...] [--seeds N,...] [--monsters N,...] [--filter TEXT] [--min-time SECONDS]
+//              [--csv PATH]
+#include <fmt/core.h>
+#include <fmt/os.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+#include "fov.hpp"
+#include "globals.hpp"
+#include "pathfinding/astar.hpp"
+#include "pathfinding/dijkstra.hpp"
+#include "procgen/caves.hpp"
+#include "rendering.hpp"
+#include "replay.hpp"
+#include "serialization.hpp"
+#include "world_init.hpp"
+#include "world_logic.hpp"
+
+namespace {
+/// One benchmark result.
+struct Result {
+  std::string name;
+  int width;
+  int height;
+  std::mt19937::result_type seed;
+  int monsters;
+  bench::Timing timing;
+};
+
+/// Return the comma separated integers in `text`.
+auto parse_list(std::string_view text) -> std::vector<int> {
+  auto values = std::vector<int>{};
+  while (!text.empty()) {
+    const auto comma = std::min(text.find(','), text.size());
+    values.emplace_back(std::atoi(std::string{text.substr(0, comma)}.c_str()));
+    text.remove_prefix(std::min(comma + 1, text.size()));
+  }
+  return values;
+}
+
+/// Return the comma separated WxH sizes in `text`.
+auto parse_sizes(std::string_view text) -> std::vector<std::array<int, 2>> {
+  auto sizes = std::vector<std::array<int, 2>>{};
+  while (!text.empty()) {
+    const auto comma = std::min(text.find(','), text.size());
+    const auto size = std::string{text.substr(0, comma)};
+    const auto x = size.find('x');
+    if (x != std::string::npos) sizes.push_back({std::atoi(size.c_str()), std::atoi(size.c_str() + x + 1)});
+    text.remove_prefix(std::min(comma + 1, text.size()));
+  }
+  return sizes;
+}
+
+/// Return a map of randomly placed walls, the input of the cellular automaton.
+auto make_noise_map(int width, int height, std::mt19937::result_type seed) -> Map {
+  auto rng = std::mt19937{seed};
+  auto map = Map{width, height};
+  auto& tiles = map.tiles.get_container();
+  for (size_t i{0}; i < tiles.size(); ++i) tiles.at(i) = i < tiles.size() * 45 / 100 ? Tiles::wall : Tiles::floor;
+  procgen::shuffle_list(tiles, rng);
+  return map;
+}
+
+/// Return a cave map before its holes are filled.
+auto make_holey_cave(int width, int height, std::mt19937::result_type seed) -> Map {
+  auto map = make_noise_map(width, height, seed);
+  for (int repeats{0}; repeats < 5; ++repeats) procgen::cave_gen_step(map);
+  with_border(width, height, [&map](int x, int y) { map.tiles.at({x, y}) = Tiles::wall; });
+  return map;
+}
+
+/// Return a finished cave map, explored everywhere.
+auto make_cave(int width, int height, std::mt19937::result_type seed) -> Map {
+  auto map = make_holey_cave(width, height, seed);
+  procgen::fill_holes(map);
+  std::fill(map.explored.begin(), map.explored.end(), true);
+  return map;
+}
+
+/// Return the pathfinding cost of `map`, 1 for floors and 0 for walls.
+auto make_cost(const Map& map) -> util::Array2D<int> {
+  auto cost = util::Array2D<int>{map.get_size()};
+  std::ranges::transform(map.tiles, cost.begin(), [](Tiles tile) { return tile == Tiles::floor ? 1 : 0; });
+  return cost;
+}
+
+/// Return the floor tile closest to `target` in reading order.
+auto find_floor(const Map& map, Position target) -> Position {
+  auto best = Position{};
+  int best_distance = std::numeric_limits<int>::max();
+  with_indexes(map, [&](int x, int y) {
+    const int distance = std::abs(x - target.x) + std::abs(y - target.y);
+    if (map.tiles.at({x, y}) == Tiles::floor && distance < best_distance) {
+      best = {x, y};
+      best_distance = distance;
+    }
+  });
+  return best;
+}
+
+/// Return the parameters of a level of `width` by `height` with `monsters` orcs and nothing else.
+auto make_level_params(int width, int height, int monsters) -> procgen::LevelParams {
+  auto params = procgen::LevelParams{};
+  params.width = width;
+  params.height = height;
+  params.orcs = monsters;
+  params.trolls = 0;
+  return params;
+}
+
+/// Return a copy of `source` stored in `Layout`.
+template <typename Layout, typename T>
+auto copy_to_layout(const util::Array2D<T>& source) -> util::Array2D<T, std::allocator<T>, Layout> {
+  auto result = util::Array2D<T, std::allocator<T>, Layout>{source.get_shape()};
+  with_indexes(source, [&](int x, int y) { result[{x, y}] = source[{x, y}]; });
+  return result;
+}
+
+/// Write one cave generation step of `tiles` to `next` using only the index API, so that layouts can be compared.
+template <typename Array>
+void cave_gen_step_indexed(const Array& tiles, Array& next) {
+  for (int y{0}; y < tiles.get_height(); ++y) {
+    for (int x{0}; x < tiles.get_width(); ++x) {
+      int walls = 0;
+      procgen::with_neighbors(x, y, [&](int nx, int ny) {
+        walls += !tiles.in_bounds({nx, ny}) || tiles[{nx, ny}] == Tiles::wall;
+      });
+      next[{x, y}] = walls < 4 ? Tiles::floor : walls >= 5 ? Tiles::wall : tiles[{x, y}];
+    }
+  }
+}
+
+/// Fill `dist` with the distance from `start` over `cost`.  Returns the number of nodes expanded.
+template <typename Array>
+auto dijkstra_indexed(const Array& cost, Position start, Array& dist) -> size_t {
+  std::fill(dist.begin(), dist.end(), std::numeric_limits<int>::max());
+  dist[start] = 0;
+  auto pathfinder = pf::Pathfinder<pf::Index2>{};
+  const auto heuristic = [&dist](pf::Index2 xy) { return dist[xy]; };
+  pathfinder.add(start, heuristic);
+  const auto is_goal = [](auto) { return false; };
+  return pf::with_graph(cost, 2, 3, start, [&](const auto& graph) {
+    return pathfinder.compute(graph, heuristic, pf::setup_set_edge(dist), is_goal);
+  });
+}
+
+/// Discards std::cout until destroyed, for routines which report to it.
+class QuietStdout {
+ public:
+  QuietStdout() : previous_{std::cout.rdbuf(nullptr)} {}
+  QuietStdout(const QuietStdout&) = delete;
+  QuietStdout& operator=(const QuietStdout&) = delete;
+  ~QuietStdout() {
+    std::cout.rdbuf(previous_);
+    std::cout.clear();
+  }
+
+ private:
+  std::streambuf* previous_;
+};
+}  // namespace
+
+int main(int argc, char** argv) {
+  auto sizes = std::vector<std::array<int, 2>>{{constants::MAP_WIDTH, constants::MAP_HEIGHT}, {256, 256}};
+  auto seeds = std::vector<int>{1};
+  auto monster_counts = std::vector<int>{16, 128};
+  auto filter = std::string_view{};
+  auto csv_path = std::string_view{};
+  auto options = bench::Options{};
+  for (int i = 1; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    if (i + 1 >= argc) {
+      fmt::print(stderr, "Missing value for argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+    const char* value = argv[++i];
+    if (arg == "--sizes") {
+      sizes = parse_sizes(value);
+    } else if (arg == "--seeds") {
+      seeds = parse_list(value);
+    } else if (arg == "--monsters") {
+      monster_counts = parse_list(value);
+    } else if (arg == "--filter") {
+      filter = value;
+    } else if (arg == "--min-time") {
+      options.min_seconds = std::atof(value);
+    } else if (arg == "--csv") {
+      csv_path = value;
+    } else {
+      fmt::print(stderr, "Unknown argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+  }
+  if (std::ranges::any_of(sizes, [](const auto& size) { return size.at(0) < 16 || size.at(1) < 16; })) {
+    fmt::print(stderr, "Sizes must be at least 16x16.\n");
+    return EXIT_FAILURE;
+  }
+
+  auto scheduler = jobs::Scheduler{};
+  scheduler.start(jobs::default_worker_count());
+  auto results = std::vector<Result>{};
+  auto current = Result{};  // The size and seed being run.
+  const auto selected = [filter](std::string_view name) { return name.find(filter) != std::string_view::npos; };
+  const auto run = [&](std::string_view name, int monsters, auto&& setup, auto&& func) {
+    if (!selected(name)) return;
+    auto& result = results.emplace_back(current);
+    result.name = name;
+    result.monsters = monsters;
+    result.timing = bench::measure(options, setup, func);
+    fmt::print(
+        "{:<28}{:>11}{:>8}{:>9}{:>8}{:>12.4f}{:>12.4f}{:>12.4f}\n",
+        result.name,
+        fmt::format("{}x{}", result.width, result.height),
+        result.seed,
+        result.monsters,
+        result.timing.iterations,
+        result.timing.min,
+        result.timing.median,
+        result.timing.max);
+  };
+  const auto nothing = []() { return 0; };
+  constexpr int LEVEL_MONSTERS = 24;  // Monsters on the levels which are generated and saved.
+
+  fmt::print(
+      "{:<28}{:>11}{:>8}{:>9}{:>8}{:>12}{:>12}{:>12}\n",
+      "name",
+      "size",
+      "seed",
+      "monsters",
+      "runs",
+      "min ms",
+      "median ms",
+      "max ms");
+  for (const auto [width, height] : sizes) {
+    for (const int seed_value : seeds) {
+      const auto seed = static_cast<std::mt19937::result_type>(seed_value);
+      current = {{}, width, height, seed, 0, {}};
+      auto cave = make_cave(width, height, seed);
+      const auto cost = make_cost(cave);
+      const auto start = find_floor(cave, {0, 0});
+      const auto goal = find_floor(cave, {width - 1, height - 1});
+      const auto center = find_floor(cave, {width / 2, height / 2});
+      const auto make_noise = [width, height, seed]() { return make_noise_map(width, height, seed); };
+      const auto make_holes = [width, height, seed]() { return make_holey_cave(width, height, seed); };
+
+      run("dijkstra2d", 0, nothing, [&](int) { return pf::dijkstra2d(start, cost); });
+      run("astar", 0, nothing, [&](int) { return pf::get_astar2d_path(cost, start, goal); });
+      run("update_fov", 0, nothing, [&](int) {
+        update_fov(cave, center);
+        return cave.visible.get_container().size();
+      });
+      run("cave_gen_step", 0, make_noise, [](Map& map) {
+        procgen::cave_gen_step(map);
+        return map.tiles.get_container().data();
+      });
+      run("cave_gen_step_parallel", 0, make_noise, [&scheduler](Map& map) {
+        procgen::cave_gen_step(map, &scheduler);
+        return map.tiles.get_container().data();
+      });
+      run("fill_holes", 0, make_holes, [](Map& map) {
+        procgen::fill_holes(map);
+        return map.tiles.get_container().data();
+      });
+      run(
+          "generate_level",
+          LEVEL_MONSTERS,
+          [&]() { return new_world(seed, make_level_params(width, height, 0)); },
+          [&](std::unique_ptr<World>& world) {
+            // Includes freezing the first level, which has no monsters.
+            const auto params = make_level_params(width, height, LEVEL_MONSTERS);
+            return &procgen::generate_level(*world, 2, params, false, &scheduler);
+          });
+      run(
+          "render_map",
+          0,
+          [&]() { return tcod::Console{width, height}; },
+          [&](tcod::Console& console) {
+            render_map(console, cave, true);
+            return console.get();
+          });
+
+      // The same work on each storage layout, through the index API which every layout shares.
+      const auto run_layout = [&]<typename Layout>(std::string_view layout_name, Layout) {
+        const auto tiles = copy_to_layout<Layout>(cave.tiles);
+        run(
+            fmt::format("layout_cave_step/{}", layout_name),
+            0,
+            [&]() { return tiles; },
+            [&](auto& next) {
+              cave_gen_step_indexed(tiles, next);
+              return next.get_container().data();
+            });
+        const auto layout_cost = copy_to_layout<Layout>(cost);
+        auto dist = util::Array2D<int, std::allocator<int>, Layout>{cost.get_shape()};
+        run(fmt::format("layout_dijkstra/{}", layout_name), 0, nothing, [&](int) {
+          return dijkstra_indexed(layout_cost, center, dist);
+        });
+      };
+      run_layout("row_major", util::RowMajorLayout{});
+      run_layout("tiled8", util::TiledLayout<8>{});
+      run_layout("tiled32", util::TiledLayout<32>{});
+      run_layout("morton", util::MortonLayout{});
+
+      for (const auto extension : {".bin", ".json"}) {
+        const auto name = fmt::format("save_load{}", extension);
+        if (!selected(name)) continue;
+        const auto world = new_world(seed, make_level_params(width, height, LEVEL_MONSTERS));
+        const auto path = std::filesystem::temp_directory_path() / fmt::format("bench_save{}", extension);
+        // load_world returns null instead of throwing, so a broken round trip would otherwise be timed as a success.
+        bool round_trip_failed = false;
+        const auto save_load = [&]() {
+          const auto quiet = QuietStdout{};
+          save_world(*world, path);
+          auto loaded = load_world(path);
+          round_trip_failed = round_trip_failed || !loaded;
+          return loaded;
+        };
+        const auto loaded = save_load();
+        if (!loaded || replay::world_checksum(*loaded) != replay::world_checksum(*world)) round_trip_failed = true;
+        if (!round_trip_failed) run(name, LEVEL_MONSTERS, nothing, [&](int) { return save_load(); });
+        std::filesystem::remove(path);
+        if (round_trip_failed) {
+          fmt::print(stderr, "{} did not load back the world it saved.\n", name);
+          return EXIT_FAILURE;
+        }
+      }
+
+      for (const int monsters : monster_counts) {
+        if (!selected("enemy_turn")) break;
+        // Every monster is woken before each turn, so they all plan and act.  The same world carries on between runs.
+        auto context = GameContext{};
+        context.scheduler.start(jobs::default_worker_count());
+        context.world = new_world(seed, make_level_params(width, height, monsters));
+        auto& world = *context.world;
+        auto& player = world.active_player();
+        player.stats.max_hp = player.stats.hp = std::numeric_limits<int>::max() / 2;
+        const auto wake_all = [&]() {
+          for (const auto actor_id : world.dormant_actors) world.schedule.push_back(actor_id);
+          world.dormant_actors.clear();
+          context.turn_arena.reset();
+          return 0;
+        };
+        run("enemy_turn", monsters, wake_all, [&](int) {
+          enemy_turn(context);
+          return world.turn;
+        });
+      }
+    }
+  }
+
+  if (!csv_path.empty()) {
+    auto csv = fmt::output_file(std::string{csv_path});
+    csv.print("name,width,height,seed,monsters,iterations,min_ms,median_ms,mean_ms,max_ms\n");
+    for (const auto& it : results) {
+      csv.print(
+          "{},{},{},{},{},{},{:.6f},{:.6f},{:.6f},{:.6f}\n",
+          it.name,
+          it.width,
+          it.height,
+          it.seed,
+          it.monsters,
+          it.timing.iterations,
+          it.timing.min,
+          it.timing.median,
+          it.timing.mean,
+          it.timing.max);
+    }
+  }
+  return EXIT_SUCCESS;
+}
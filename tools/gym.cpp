@@ -0,0 +1,122 @@
+// Serves environments for training agents over the binary reset/step protocol described in gym.hpp.
+//
+// By default the protocol is spoken over stdin and stdout, so a training script can start this as a subprocess.
+// Diagnostics which would otherwise go to stdout are sent to stderr, so that they never mix with the protocol.
+// With `--socket PATH` it listens on a Unix domain socket instead and serves one client at a time until a client
+// sends quit.  Steps for many environments can be batched into one request and are run on every core.
+//
+// Usage: gym [--envs N] [--radius N] [--threads N] [--socket PATH]
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "gym.hpp"
+#include "jobs.hpp"
+
+#ifndef _WIN32
+namespace {
+/// Listen on a Unix domain socket at `path` and serve each client in turn.
+auto serve_socket(gym::Server& server, const std::string& path) -> int {
+  auto address = sockaddr_un{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    fmt::print(stderr, "Socket path is too long: {}\n", path);
+    return EXIT_FAILURE;
+  }
+  path.copy(address.sun_path, path.size());
+  const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(path.c_str());
+  if (listener < 0 || bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(listener, 1) != 0) {
+    fmt::print(stderr, "Could not listen on {}\n", path);
+    return EXIT_FAILURE;
+  }
+  fmt::print(stderr, "Listening on {}\n", path);
+  bool keep_serving = true;
+  while (keep_serving) {
+    const int client = accept(listener, nullptr, nullptr);
+    if (client < 0) continue;
+    std::FILE* in = fdopen(client, "rb");
+    std::FILE* out = fdopen(dup(client), "wb");
+    keep_serving = server.serve(in, out);
+    std::fclose(out);
+    std::fclose(in);
+  }
+  ::close(listener);
+  ::unlink(path.c_str());
+  return EXIT_SUCCESS;
+}
+}  // namespace
+#endif
+
+int main(int argc, char** argv) {
+  int env_count = 1;
+  int radius = 10;
+  unsigned threads = jobs::default_worker_count() + 1;
+  auto socket_path = std::string{};
+  for (int i = 1; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    const bool has_value = i + 1 < argc;
+    if (arg == "--envs" && has_value) {
+      env_count = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--radius" && has_value) {
+      radius = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--threads" && has_value) {
+      threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--socket" && has_value) {
+      socket_path = argv[++i];
+    } else {
+      fmt::print(stderr, "Unknown argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+  }
+
+#ifdef _WIN32
+  if (!socket_path.empty()) {
+    fmt::print(stderr, "Unix sockets are not supported on this platform.\n");
+    return EXIT_FAILURE;
+  }
+#endif
+  // Anything printed to stdout would corrupt the protocol, so the protocol gets its own copy of stdout and stdout
+  // itself is pointed at stderr.  This is done before any world is created.
+  std::FILE* protocol_out = nullptr;
+  if (socket_path.empty()) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    const int protocol_fd = _dup(_fileno(stdout));
+    _setmode(protocol_fd, _O_BINARY);
+    protocol_out = _fdopen(protocol_fd, "wb");
+    _dup2(_fileno(stderr), _fileno(stdout));
+#else
+    protocol_out = fdopen(dup(STDOUT_FILENO), "wb");
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+#endif
+    if (!protocol_out) {
+      fmt::print(stderr, "Could not open the protocol stream.\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto scheduler = jobs::Scheduler{};
+  scheduler.start(threads - 1);
+  auto server = gym::Server{env_count, radius, scheduler};
+#ifndef _WIN32
+  if (!socket_path.empty()) return serve_socket(server, socket_path);
+#endif
+  std::ignore = server.serve(stdin, protocol_out);
+  std::fclose(protocol_out);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+// Headless simulation without a window or display.
+//
+// Creates a new world with new_world and has a bot policy play it through the normal action classes for a number of
+// turns as fast as possible, then reports the throughput in turns per second.  Useful for soak tests and profiling.
+//
+// The session can be recorded for the replay tool, which makes the run reproducible.
+//
+// With --alloc-report, builds configured with ALLOCATION_STATS write what each turn allocated by subsystem to PATH as
+// CSV with the columns turn, subsystem, allocations, bytes and peak_bytes.  See src/memory_stats.hpp.
+//
+// With --trace, the trace zones of the whole run are written to PATH as Chrome trace-event JSON.  See src/trace.hpp.
+//
+// Usage: headless [--turns N] [--seed N] [--policy random|explorer] [--god] [--simulate-frozen-levels]
+//                 [--record PATH] [--export-maps PATH] [--alloc-report PATH] [--trace PATH]
+#include <fmt/core.h>
+#include <fmt/os.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string_view>
+
+#include "bot.hpp"
+#include "globals.hpp"
+#include "headless.hpp"
+#include "memory_stats.hpp"
+#include "memory_stats_hooks.hpp"
+#include "replay.hpp"
+#include "trace.hpp"
+#include "world_init.hpp"
+
+int main(int argc, char** argv) {
+  auto context = GameContext{};
+  int turn_count = 10'000;
+  std::mt19937::result_type seed = 0;
+  auto policy_name = std::string_view{"explorer"};
+  bool god_mode = false;  // Keep the player alive so that every run lasts the requested number of turns.
+  auto alloc_report_path = std::filesystem::path{};
+  auto trace_path = std::filesystem::path{};
+  for (int i = 1; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    const bool has_value = i + 1 < argc;
+    if (arg == "--god") {
+      god_mode = true;
+    } else if (arg == "--simulate-frozen-levels") {
+      context.simulate_frozen_levels = true;
+    } else if (arg == "--turns" && has_value) {
+      turn_count = std::atoi(argv[++i]);
+    } else if (arg == "--seed" && has_value) {
+      seed = static_cast<std::mt19937::result_type>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--policy" && has_value) {
+      policy_name = argv[++i];
+    } else if (arg == "--record" && has_value) {
+      context.record_path = argv[++i];
+    } else if (arg == "--export-maps" && has_value) {
+      context.map_export = std::make_unique<MapExporter>(argv[++i], constants::MAP_WIDTH, constants::MAP_HEIGHT);
+    } else if (arg == "--alloc-report" && has_value) {
+      alloc_report_path = argv[++i];
+    } else if (arg == "--trace" && has_value) {
+      trace_path = argv[++i];
+    } else {
+      fmt::print(stderr, "Unknown argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+  }
+  auto policy = bot::make_policy(policy_name, seed);
+  if (!policy) {
+    fmt::print(stderr, "Unknown policy: {}\n", policy_name);
+    return EXIT_FAILURE;
+  }
+  if (!alloc_report_path.empty() && !memstats::ENABLED) {
+    fmt::print(stderr, "--alloc-report needs a build configured with -DALLOCATION_STATS=ON\n");
+    return EXIT_FAILURE;
+  }
+
+  if (!trace_path.empty()) trace::enable();
+  context.scheduler.start(jobs::default_worker_count());
+  context.world = new_world(seed, {}, &context.scheduler);
+  if (god_mode) {
+    auto& player = context.world->active_player();
+    player.stats.max_hp = player.stats.hp = std::numeric_limits<int>::max() / 2;
+  }
+  replay::begin_recording(context);
+  auto& world = *context.world;
+
+  auto alloc_report = std::optional<fmt::ostream>{};
+  auto alloc_total = memstats::Counters{};
+  if (!alloc_report_path.empty()) {
+    alloc_report.emplace(fmt::output_file(alloc_report_path.string()));
+    alloc_report->print("turn,subsystem,allocations,bytes,peak_bytes\n");
+  }
+  const auto write_alloc_report = [&](int turn) {
+    if (!alloc_report) return;
+    const auto allocated = memstats::get_last(memstats::Window::turn);
+    for (size_t i{0}; i < memstats::SUBSYSTEM_COUNT; ++i) {
+      const auto& it = allocated.at(i);
+      alloc_report->print(
+          "{},{},{},{},{}\n", turn, memstats::SUBSYSTEM_NAMES.at(i), it.allocations, it.bytes, it.peak_bytes);
+    }
+    const auto total = memstats::get_total(allocated);
+    alloc_total.allocations += total.allocations;
+    alloc_total.bytes += total.bytes;
+  };
+
+  const auto report = headless::run(context, *policy, turn_count, write_alloc_report);
+  const auto& player = world.active_player();
+  fmt::print(
+      "{} turns in {:.3f}s ({:.0f} turns/s) with the {} policy.\n",
+      report.turns,
+      report.seconds,
+      report.turns_per_second(),
+      policy_name);
+  fmt::print(
+      "Player {} on dungeon level {} at level {} with {}/{} HP, {} level ups, {} failed actions.\n",
+      report.player_died ? "died" : "survived",
+      world.current_map_id.level,
+      player.stats.level,
+      player.stats.hp,
+      player.stats.max_hp,
+      report.level_ups,
+      report.failed_actions);
+  if (alloc_report && report.turns) {
+    fmt::print(
+        "{:.1f} allocations and {:.0f} bytes per turn, written to {}.\n",
+        static_cast<double>(alloc_total.allocations) / report.turns,
+        static_cast<double>(alloc_total.bytes) / report.turns,
+        alloc_report_path.string());
+  }
+  if (!trace_path.empty()) {
+    fmt::print("{} trace zones written to {}.\n", trace::write_chrome_trace(trace_path), trace_path.string());
+  }
+  replay::end_recording(context);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,306 @@
+// Pathfinding benchmarks on grid maps in the .map and .scen formats, see src/pathfinding/scenario.hpp.
+//
+// `generate` writes a cave map made by the level generator and random queries on it to DIR, so that benchmarks can be
+// run without downloading the published sets.  Their optimal lengths are half the distance with cardinal steps costing
+// 2 and diagonal steps costing 3, the costs the game uses.
+//
+// Otherwise each query of each .scen file given is run through every pathfinder with the same costs.  A path is
+// checked to be connected, to only cross open tiles and to be as short as the distance found by a full Dijkstra search
+// from its start.  For each pathfinder the number of invalid and longer than optimal paths, the mean nodes expanded
+// and the mean time per query are printed.  Exits with failure if any path was invalid or longer than optimal.
+//
+// With --csv every query is also written to PATH with the columns pathfinder, scenario, index, start_x, start_y,
+// goal_x, goal_y, optimal, length, expanded and microseconds.  Length is -1 where no path was found.
+//
+// Usage: pathbench generate DIR [--size WxH] [--seed N] [--scenarios N]
+//        pathbench [--csv PATH] SCEN...
+#include <fmt/core.h>
+#include <fmt/os.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+#include "pathfinding/astar.hpp"
+#include "pathfinding/dijkstra.hpp"
+#include "pathfinding/scenario.hpp"
+#include "world_init.hpp"
+
+namespace {
+constexpr int CARDINAL = 2;
+constexpr int DIAGONAL = 3;
+constexpr int UNREACHABLE = std::numeric_limits<int>::max();
+
+/// A path found by a pathfinder, from the goal to the start, and the number of nodes expanded to find it.
+struct Found {
+  std::vector<pf::Index2> path;
+  size_t expanded = 0;
+};
+
+/// A pathfinder being compared.
+struct Runner {
+  std::string_view name;
+  std::function<Found(const util::Array2D<int>& cost, pf::Index2 start, pf::Index2 goal)> find;
+};
+
+/// The totals of one pathfinder over every query.
+struct Totals {
+  int queries = 0;
+  int invalid = 0;
+  int suboptimal = 0;
+  double excess = 0;  // Summed length over the optimal length of suboptimal paths.
+  double expanded = 0;
+  double microseconds = 0;
+};
+
+/// A* with the heuristic the game uses.
+auto find_astar(const util::Array2D<int>& cost, pf::Index2 start, pf::Index2 goal) -> Found {
+  auto found = Found{};
+  const auto allocator = std::allocator<pf::Index2>{};
+  found.path = pf::get_astar2d_path(cost, start, goal, CARDINAL, DIAGONAL, allocator, &found.expanded);
+  return found;
+}
+
+/// Dijkstra which stops once the goal is reached.
+auto find_dijkstra(const util::Array2D<int>& cost, pf::Index2 start, pf::Index2 goal) -> Found {
+  auto dist = util::Array2D<int>{cost.get_shape(), UNREACHABLE};
+  auto flow = pf::new_flow_array(cost.get_shape());
+  dist.at(start) = 0;
+  auto pathfinder = pf::Pathfinder<pf::Index2>{};
+  const auto heuristic = pf::setup_heuristic(dist);
+  pathfinder.add(start, heuristic);
+  const auto is_goal = [&goal](pf::Index2 pos) { return pos == goal; };
+  auto found = Found{};
+  found.expanded = pf::with_graph(cost, CARDINAL, DIAGONAL, start, [&](const auto& graph) {
+    return pathfinder.compute(graph, heuristic, pf::setup_set_edge(dist, flow), is_goal);
+  });
+  found.path = pf::get_path(flow, goal);
+  return found;
+}
+
+/// Return the cost of walking `path` from its last index to its first, or -1 if it is not a walkable path between
+/// `goal` and `start`.
+auto get_path_cost(
+    const util::Array2D<int>& cost, const std::vector<pf::Index2>& path, pf::Index2 start, pf::Index2 goal) -> int {
+  if (path.empty() || path.front() != goal || path.back() != start) return -1;
+  int total = 0;
+  for (size_t i{1}; i < path.size(); ++i) {
+    const auto dest = path.at(i - 1);
+    const auto origin = path.at(i);
+    const int dx = std::abs(dest.x - origin.x);
+    const int dy = std::abs(dest.y - origin.y);
+    if (!cost.in_bounds(dest) || cost.at(dest) <= 0 || dx > 1 || dy > 1 || dx + dy == 0) return -1;
+    total += (dx + dy == 2 ? DIAGONAL : CARDINAL) * cost.at(dest);
+  }
+  return total;
+}
+
+/// Return the WxH size in `text`, or {0, 0} if it is malformed.
+auto parse_size(std::string_view text) -> std::array<int, 2> {
+  const auto size = std::string{text};
+  const auto x = size.find('x');
+  if (x == std::string::npos) return {0, 0};
+  return {std::atoi(size.c_str()), std::atoi(size.c_str() + x + 1)};
+}
+
+/// Write a generated map and its queries to `dir`.
+auto generate(int argc, char** argv) -> int {
+  if (argc < 3) {
+    fmt::print(stderr, "Usage: pathbench generate DIR [--size WxH] [--seed N] [--scenarios N]\n");
+    return EXIT_FAILURE;
+  }
+  const auto dir = std::filesystem::path{argv[2]};
+  auto size = std::array{256, 256};
+  auto seed = std::mt19937::result_type{1};
+  int count = 1000;
+  for (int i = 3; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    if (i + 1 >= argc) {
+      fmt::print(stderr, "Missing value for argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+    const char* value = argv[++i];
+    if (arg == "--size") {
+      size = parse_size(value);
+    } else if (arg == "--seed") {
+      seed = static_cast<std::mt19937::result_type>(std::atoll(value));
+    } else if (arg == "--scenarios") {
+      count = std::atoi(value);
+    } else {
+      fmt::print(stderr, "Unknown argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+  }
+  if (size.at(0) < 16 || size.at(1) < 16) {
+    fmt::print(stderr, "Size must be at least 16x16.\n");
+    return EXIT_FAILURE;
+  }
+
+  auto params = procgen::LevelParams{};
+  params.width = size.at(0);
+  params.height = size.at(1);
+  params.orcs = 0;
+  params.trolls = 0;
+  const auto world = new_world(seed, params);
+  auto cost = util::Array2D<int>{size};
+  std::ranges::transform(world->active_map().tiles, cost.begin(), [](Tiles tile) { return tile == Tiles::floor; });
+  auto floors = std::vector<pf::Index2>{};
+  with_indexes(cost, [&](int x, int y) {
+    if (cost.at({x, y})) floors.push_back({x, y});
+  });
+  if (floors.size() < 2) {
+    fmt::print(stderr, "The generated map has no room for scenarios.\n");
+    return EXIT_FAILURE;
+  }
+
+  const auto name = fmt::format("cave-{}x{}-{}", size.at(0), size.at(1), seed);
+  auto rng = std::mt19937{seed};
+  auto pick = std::uniform_int_distribution<size_t>{0, floors.size() - 1};
+  auto scenarios = std::vector<pf::Scenario>{};
+  while (std::ssize(scenarios) < count) {
+    const auto start = floors.at(pick(rng));
+    const auto goal = floors.at(pick(rng));
+    const int distance = pf::dijkstra2d(start, cost, CARDINAL, DIAGONAL).at(goal);
+    if (start == goal || distance == UNREACHABLE) continue;
+    const double length = distance / 2.0;
+    scenarios.push_back({static_cast<int>(length / 4), name + ".map", size.at(0), size.at(1), start, goal, length});
+  }
+  std::ranges::sort(scenarios, {}, &pf::Scenario::optimal_length);
+
+  std::filesystem::create_directories(dir);
+  auto map_file = std::ofstream{dir / (name + ".map")};
+  pf::write_grid_map(map_file, cost);
+  auto scen_file = std::ofstream{dir / (name + ".map.scen")};
+  pf::write_scenarios(scen_file, scenarios);
+  fmt::print("Wrote {} scenarios to {}\n", scenarios.size(), (dir / (name + ".map.scen")).string());
+  return EXIT_SUCCESS;
+}
+
+/// Run every query of the .scen files given through every pathfinder.
+auto run(int argc, char** argv) -> int {
+  auto csv_path = std::string_view{};
+  auto scen_paths = std::vector<std::filesystem::path>{};
+  for (int i = 1; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    if (arg == "--csv" && i + 1 < argc) {
+      csv_path = argv[++i];
+    } else if (arg.starts_with("--")) {
+      fmt::print(stderr, "Unknown argument: {}\n", arg);
+      return EXIT_FAILURE;
+    } else {
+      scen_paths.emplace_back(arg);
+    }
+  }
+  if (scen_paths.empty()) {
+    fmt::print(stderr, "Usage: pathbench [--csv PATH] SCEN...\n       pathbench generate DIR [options]\n");
+    return EXIT_FAILURE;
+  }
+
+  const auto runners = std::array{Runner{"dijkstra", find_dijkstra}, Runner{"astar", find_astar}};
+  auto totals = std::array<Totals, runners.size()>{};
+  auto csv = std::optional<fmt::ostream>{};
+  if (!csv_path.empty()) {
+    csv.emplace(fmt::output_file(std::string{csv_path}));
+    csv->print("pathfinder,scenario,index,start_x,start_y,goal_x,goal_y,optimal,length,expanded,microseconds\n");
+  }
+  for (const auto& scen_path : scen_paths) {
+    const auto scenarios = pf::read_scenarios(scen_path);
+    auto maps = std::map<std::string, util::Array2D<int>>{};
+    for (size_t index{0}; index < scenarios.size(); ++index) {
+      const auto& scenario = scenarios.at(index);
+      auto [map_it, inserted] = maps.try_emplace(scenario.map);
+      if (inserted) map_it->second = pf::read_grid_map(scen_path.parent_path() / scenario.map);
+      const auto& cost = map_it->second;
+      if (!cost.in_bounds(scenario.start) || !cost.in_bounds(scenario.goal)) {
+        const auto where = fmt::format("Scenario {} of {}", index + 1, scen_path.string());
+        throw std::runtime_error(where + " is outside of its map.");
+      }
+      const int optimal = pf::dijkstra2d(scenario.start, cost, CARDINAL, DIAGONAL).at(scenario.goal);
+      for (size_t r{0}; r < runners.size(); ++r) {
+        const auto time_start = std::chrono::steady_clock::now();
+        const auto found = runners.at(r).find(cost, scenario.start, scenario.goal);
+        const auto microseconds =
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - time_start).count();
+        bench::keep(found);
+        const bool no_path = found.path.size() == 1 && scenario.start != scenario.goal;
+        const int length = no_path ? -1 : get_path_cost(cost, found.path, scenario.start, scenario.goal);
+        auto& total = totals.at(r);
+        ++total.queries;
+        total.expanded += static_cast<double>(found.expanded);
+        total.microseconds += microseconds;
+        if (no_path != (optimal == UNREACHABLE) || (!no_path && length < 0)) {
+          ++total.invalid;
+        } else if (length > optimal) {
+          ++total.suboptimal;
+          total.excess += static_cast<double>(length) / optimal;
+        }
+        if (csv) {
+          csv->print(
+              "{},{},{},{},{},{},{},{},{},{},{:.3f}\n",
+              runners.at(r).name,
+              scen_path.filename().string(),
+              index,
+              scenario.start.x,
+              scenario.start.y,
+              scenario.goal.x,
+              scenario.goal.y,
+              optimal == UNREACHABLE ? -1 : optimal,
+              length,
+              found.expanded,
+              microseconds);
+        }
+      }
+    }
+  }
+
+  fmt::print(
+      "{:<12}{:>10}{:>10}{:>12}{:>14}{:>14}{:>12}\n",
+      "pathfinder",
+      "queries",
+      "invalid",
+      "suboptimal",
+      "mean excess",
+      "mean expanded",
+      "us/query");
+  bool any_failed = false;
+  for (size_t r{0}; r < runners.size(); ++r) {
+    const auto& total = totals.at(r);
+    const double queries = std::max(total.queries, 1);
+    fmt::print(
+        "{:<12}{:>10}{:>10}{:>12}{:>13.2f}%{:>14.1f}{:>12.2f}\n",
+        runners.at(r).name,
+        total.queries,
+        total.invalid,
+        total.suboptimal,
+        total.suboptimal ? (total.excess / total.suboptimal - 1.0) * 100.0 : 0.0,
+        total.expanded / queries,
+        total.microseconds / queries);
+    any_failed = any_failed || total.invalid || total.suboptimal;
+  }
+  return any_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  try {
+    if (argc > 1 && std::string_view{argv[1]} == "generate") return generate(argc, argv);
+    return run(argc, argv);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "{}\n", e.what());
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,60 @@
+// Replays a recorded session without a window, as fast as possible.
+//
+// Sessions are recorded by running the game or the headless tool with `--record PATH`.  The replay starts from the
+// recorded world, performs every recorded command, and then checks that it ended in the recorded state.  The exit
+// status is non-zero if it did not.  Replay throughput in turns per second is the standard performance metric.
+//
+// Usage: replay PATH [--repeat N]
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <string_view>
+
+#include "globals.hpp"
+#include "replay.hpp"
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fmt::print(stderr, "Usage: replay PATH [--repeat N]\n");
+    return EXIT_FAILURE;
+  }
+  int repeat_count = 1;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (std::string_view{argv[i]} == "--repeat") {
+      repeat_count = std::max(1, std::atoi(argv[i + 1]));
+    } else {
+      fmt::print(stderr, "Unknown argument: {}\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto recording = replay::Recording{};
+  try {
+    recording = replay::load_recording(argv[1]);
+  } catch (const std::exception& exc) {
+    fmt::print(stderr, "Failed to load {}: {}\n", argv[1], exc.what());
+    return EXIT_FAILURE;
+  }
+
+  auto context = GameContext{};
+  context.scheduler.start(jobs::default_worker_count());
+  bool all_match = true;
+  double best_turns_per_second = 0;
+  for (int run{0}; run < repeat_count; ++run) {
+    const auto report = replay::play(context, recording);
+    all_match = all_match && report.matches;
+    best_turns_per_second = std::max(best_turns_per_second, report.turns_per_second());
+    fmt::print(
+        "{} commands, {} turns in {:.3f}s ({:.0f} turns/s), checksum {:016x} {}\n",
+        report.commands,
+        report.turns,
+        report.seconds,
+        report.turns_per_second(),
+        report.checksum,
+        report.matches ? "matches" : fmt::format("does not match recorded {:016x}", recording.checksum));
+  }
+  fmt::print("best: {:.0f} turns/s\n", best_turns_per_second);
+  return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,94 @@
+// Stress scenario for very large monster populations.
+//
+// Generates a single cave level big enough to hold the requested number of monsters using the same
+// procgen::generate_level path as normal play, then runs turns with a wandering player and reports the latency of
+// each full turn (player action, FOV update and enemy_turn).
+//
+// Usage: stress [--actors N] [--turns N] [--seed N]
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "bot.hpp"
+#include "replay.hpp"
+#include "fov.hpp"
+#include "globals.hpp"
+#include "procgen/caves.hpp"
+#include "world_init.hpp"
+#include "world_logic.hpp"
+
+namespace {
+/// Return the value at percentile `p` of an already sorted list.
+auto percentile(const std::vector<double>& sorted, double p) -> double {
+  if (sorted.empty()) return 0;
+  const auto index = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size())) - 1;
+  return sorted.at(std::clamp<size_t>(index, 0, sorted.size() - 1));
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  int actor_count = 100'000;
+  int turn_count = 200;
+  std::mt19937::result_type seed = 0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const auto arg = std::string_view{argv[i]};
+    if (arg == "--actors") {
+      actor_count = std::atoi(argv[i + 1]);
+    } else if (arg == "--turns") {
+      turn_count = std::atoi(argv[i + 1]);
+    } else if (arg == "--seed") {
+      seed = static_cast<std::mt19937::result_type>(std::strtoul(argv[i + 1], nullptr, 10));
+    } else {
+      fmt::print(stderr, "Unknown argument: {}\n", arg);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Roughly half of a cave is floor, leave plenty of room for monsters outside of the starting FOV.
+  const int side = std::max(constants::MAP_WIDTH, static_cast<int>(std::ceil(std::sqrt(actor_count * 4.0))));
+  auto params = procgen::LevelParams{};
+  params.width = side;
+  params.height = side;
+  params.orcs = actor_count - actor_count / 5;
+  params.trolls = actor_count / 5;
+
+  auto context = GameContext{};
+  context.scheduler.start(jobs::default_worker_count());
+  const auto setup_start = std::chrono::steady_clock::now();
+  context.world = new_world(seed, params, &context.scheduler);
+  const auto setup_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - setup_start).count();
+  auto& world = *context.world;
+  world.active_player().stats.max_hp = world.active_player().stats.hp = std::numeric_limits<int>::max() / 2;
+  fmt::print(
+      "Generated {}x{} level with {} actors in {:.3f}s.\n", side, side, world.active_actors.size(), setup_time);
+
+  auto player_policy = bot::RandomWalk{seed};
+  auto latencies = std::vector<double>{};
+  latencies.reserve(turn_count);
+  for (int turn{0}; turn < turn_count && world.active_player().stats.hp > 0; ++turn) {
+    const auto turn_start = std::chrono::steady_clock::now();
+    std::ignore = replay::to_action(player_policy.next_command(world))->perform(context, world.active_player());
+    update_fov(world.active_map(), world.active_player().pos);
+    enemy_turn(context);
+    latencies.emplace_back(
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - turn_start).count());
+  }
+
+  std::ranges::sort(latencies);
+  fmt::print(
+      "{} turns, {} actors remaining, {} awake. Turn latency ms: p50={:.3f} p90={:.3f} p99={:.3f} max={:.3f}\n",
+      latencies.size(),
+      world.active_actors.size(),
+      world.schedule.size() - 1,
+      percentile(latencies, 50),
+      percentile(latencies, 90),
+      percentile(latencies, 99),
+      latencies.empty() ? 0.0 : latencies.back());
+  return EXIT_SUCCESS;
+}